@@ -112,9 +112,34 @@ void block_write(struct block* block, block_sector_t sector, const void* buffer)
   block->write_cnt++;
 }
 
+/* Writes CNT consecutive sectors starting at SECTOR to BLOCK
+   from BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Uses a single multi-sector transfer if the driver supports
+   one, otherwise writes the sectors one at a time. */
+void block_write_multiple(struct block* block, block_sector_t sector, const void* buffer,
+                          block_sector_t cnt) {
+  const uint8_t* p = buffer;
+  block_sector_t i;
+
+  if (cnt == 0)
+    return;
+  check_sector(block, sector);
+  check_sector(block, sector + cnt - 1);
+  ASSERT(block->type != BLOCK_FOREIGN);
+  if (block->ops->write_multiple != NULL)
+    block->ops->write_multiple(block->aux, sector, buffer, cnt);
+  else
+    for (i = 0; i < cnt; i++)
+      block->ops->write(block->aux, sector + i, p + i * BLOCK_SECTOR_SIZE);
+  block->write_cnt += cnt;
+}
+
 /* Returns the number of sectors in BLOCK. */
 block_sector_t block_size(struct block* block) { return block->size; }
 
+/* Returns the number of sectors read from BLOCK so far. */
+unsigned long long block_read_cnt(struct block* block) { return block->read_cnt; }
+
 /* Returns BLOCK's name (e.g. "hda"). */
 const char* block_name(struct block* block) { return block->name; }
 
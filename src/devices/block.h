@@ -52,6 +52,8 @@ struct block* block_next(struct block*);
 block_sector_t block_size(struct block*);
 void block_read(struct block*, block_sector_t, void*);
 void block_write(struct block*, block_sector_t, const void*);
+void block_write_multiple(struct block*, block_sector_t, const void*, block_sector_t cnt);
+unsigned long long block_read_cnt(struct block*);
 const char* block_name(struct block*);
 enum block_type block_type(struct block*);
 
@@ -63,6 +65,9 @@ void block_print_stats(void);
 struct block_operations {
   void (*read)(void* aux, block_sector_t, void* buffer);
   void (*write)(void* aux, block_sector_t, const void* buffer);
+
+  /* Optional: writes CNT consecutive sectors in one transfer. */
+  void (*write_multiple)(void* aux, block_sector_t, const void* buffer, block_sector_t cnt);
 };
 
 struct block* block_register(const char* name, enum block_type, const char* extra_info,
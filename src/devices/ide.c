@@ -50,6 +50,10 @@
 #define CMD_READ_SECTOR_RETRY 0x20  /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30 /* WRITE SECTOR with retries. */
 
+/* Most sectors a single READ/WRITE SECTOR command can transfer
+   without using a sector count of 0, which means 256. */
+#define IDE_MAX_MULTIPLE 255
+
 /* An ATA device. */
 struct ata_disk {
   char name[8];            /* Name, e.g. "hda". */
@@ -83,7 +87,7 @@ static void reset_channel(struct channel*);
 static bool check_device_type(struct ata_disk*);
 static void identify_ata_device(struct ata_disk*);
 
-static void select_sector(struct ata_disk*, block_sector_t);
+static void select_sector(struct ata_disk*, block_sector_t, uint8_t cnt);
 static void issue_pio_command(struct channel*, uint8_t command);
 static void input_sector(struct channel*, void*);
 static void output_sector(struct channel*, const void*);
@@ -314,7 +318,7 @@ static void ide_read(void* d_, block_sector_t sec_no, void* buffer) {
   struct ata_disk* d = d_;
   struct channel* c = d->channel;
   lock_acquire(&c->lock);
-  select_sector(d, sec_no);
+  select_sector(d, sec_no, 1);
   issue_pio_command(c, CMD_READ_SECTOR_RETRY);
   sema_down(&c->completion_wait);
   if (!wait_while_busy(d))
@@ -332,7 +336,7 @@ static void ide_write(void* d_, block_sector_t sec_no, const void* buffer) {
   struct ata_disk* d = d_;
   struct channel* c = d->channel;
   lock_acquire(&c->lock);
-  select_sector(d, sec_no);
+  select_sector(d, sec_no, 1);
   issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
   if (!wait_while_busy(d))
     PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no);
@@ -341,18 +345,53 @@ static void ide_write(void* d_, block_sector_t sec_no, const void* buffer) {
   lock_release(&c->lock);
 }
 
-static struct block_operations ide_operations = {ide_read, ide_write};
+/* Writes CNT consecutive sectors starting at SEC_NO to disk D
+   from BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes,
+   issuing one WRITE SECTOR command per IDE_MAX_MULTIPLE sectors
+   instead of one per sector.  Returns after the disk has
+   acknowledged receiving all of the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void ide_write_multiple(void* d_, block_sector_t sec_no, const void* buffer,
+                               block_sector_t cnt) {
+  struct ata_disk* d = d_;
+  struct channel* c = d->channel;
+  const uint8_t* p = buffer;
+
+  lock_acquire(&c->lock);
+  while (cnt > 0) {
+    uint8_t chunk = cnt < IDE_MAX_MULTIPLE ? cnt : IDE_MAX_MULTIPLE;
+
+    select_sector(d, sec_no, chunk);
+    issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
+    for (uint8_t i = 0; i < chunk; i++) {
+      /* The disk raises DRQ for each sector in turn and
+         interrupts once it has taken each one. */
+      if (!wait_while_busy(d))
+        PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no + i);
+      output_sector(c, p);
+      sema_down(&c->completion_wait);
+      p += BLOCK_SECTOR_SIZE;
+    }
+    sec_no += chunk;
+    cnt -= chunk;
+  }
+  lock_release(&c->lock);
+}
+
+static struct block_operations ide_operations = {ide_read, ide_write, ide_write_multiple};
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
-static void select_sector(struct ata_disk* d, block_sector_t sec_no) {
+   writes SEC_NO and the count CNT of sectors to transfer to the
+   disk's sector selection registers.  (We use LBA mode.) */
+static void select_sector(struct ata_disk* d, block_sector_t sec_no, uint8_t cnt) {
   struct channel* c = d->channel;
 
   ASSERT(sec_no < (1UL << 28));
+  ASSERT(cnt > 0);
 
   select_device_wait(d);
-  outb(reg_nsect(c), 1);
+  outb(reg_nsect(c), cnt);
   outb(reg_lbal(c), sec_no);
   outb(reg_lbam(c), sec_no >> 8);
   outb(reg_lbah(c), (sec_no >> 16));
@@ -284,7 +284,17 @@ static void partition_read(void* p_, block_sector_t sector, void* buffer) {
    acknowledged receiving the data. */
 static void partition_write(void* p_, block_sector_t sector, const void* buffer) {
   struct partition* p = p_;
-  cache_write(p->block, p->start + sector, buffer);
+  cache_write(p->block, p->start + sector, buffer, CACHE_NO_OWNER);
 }
 
-static struct block_operations partition_operations = {partition_read, partition_write};
+/* Writes CNT consecutive sectors starting at SECTOR to partition
+   P from BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE
+   bytes. */
+static void partition_write_multiple(void* p_, block_sector_t sector, const void* buffer,
+                                     block_sector_t cnt) {
+  struct partition* p = p_;
+  block_write_multiple(p->block, p->start + sector, buffer, cnt);
+}
+
+static struct block_operations partition_operations = {partition_read, partition_write,
+                                                        partition_write_multiple};
@@ -5,6 +5,9 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/memprof.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -13,6 +16,10 @@
 #include "devices/block.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/share.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -116,6 +123,9 @@ void shutdown_power_off(void) {
 static void print_stats(void) {
   timer_print_stats();
   thread_print_stats();
+  malloc_print_stats();
+  memprof_print();
+  slab_print_stats();
 #ifdef FILESYS
   block_print_stats();
 #endif
@@ -124,4 +134,8 @@ static void print_stats(void) {
 #ifdef USERPROG
   exception_print_stats();
 #endif
+#ifdef VM
+  frame_print_stats();
+  share_print_stats();
+#endif
 }
@@ -12,6 +12,9 @@
 #include <stdio.h>
 #include <string.h>
 
+/* Number of directory entries fetched per getdents() call. */
+#define LS_BATCH 16
+
 static bool list_dir(const char* dir, bool verbose) {
   int dir_fd = open(dir);
   if (dir_fd == -1) {
@@ -20,35 +23,30 @@ static bool list_dir(const char* dir, bool verbose) {
   }
 
   if (isdir(dir_fd)) {
-    char name[READDIR_MAX_LEN];
+    struct dirent entries[LS_BATCH];
+    int cnt, i;
 
     printf("%s", dir);
     if (verbose)
       printf(" (inumber %d)", inumber(dir_fd));
     printf(":\n");
 
-    while (readdir(dir_fd, name)) {
-      printf("%s", name);
-      if (verbose) {
-        char full_name[128];
-        int entry_fd;
-
-        snprintf(full_name, sizeof full_name, "%s/%s", dir, name);
-        entry_fd = open(full_name);
-
-        printf(": ");
-        if (entry_fd != -1) {
-          if (isdir(entry_fd))
+    /* getdents() returns each entry's type, size, and inumber
+       along with its name, so there is no need to open every
+       entry to print a verbose listing. */
+    while ((cnt = getdents(dir_fd, entries, LS_BATCH)) > 0)
+      for (i = 0; i < cnt; i++) {
+        printf("%s", entries[i].name);
+        if (verbose) {
+          printf(": ");
+          if (entries[i].isdir)
             printf("directory");
           else
-            printf("%d-byte file", filesize(entry_fd));
-          printf(", inumber %d", inumber(entry_fd));
-        } else
-          printf("open failed");
-        close(entry_fd);
+            printf("%d-byte file", entries[i].length);
+          printf(", inumber %d", entries[i].inumber);
+        }
+        printf("\n");
       }
-      printf("\n");
-    }
   } else
     printf("%s: not a directory\n", dir);
   close(dir_fd);
@@ -2,13 +2,38 @@
 #include "devices/block.h"
 #include "threads/synch.h"
 #include <string.h>
+#include <stdlib.h>
+#include <debug.h>
 #include "filesys/off_t.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* Identifies a valid warm-up list. */
+#define WARMUP_MAGIC 0x4d524157
+
+/* Maximum number of sectors in the warm-up list. */
+#define WARMUP_MAX 126
+
+/* List of hot sectors saved at shutdown and prefetched at the
+   next boot, stored raw in WARMUP_SECTOR.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct warmup_disk {
+  unsigned magic;                     /* Magic number. */
+  uint32_t cnt;                       /* Number of sectors in list. */
+  block_sector_t sectors[WARMUP_MAX]; /* Hot sectors. */
+};
 
 static struct cache_item buffer_cache[64];
 static struct lock
     global_cache_lock;               // global cache lock for cache misses (compulsory and capacity)
 static struct lock sector_locks[64]; // read/write sector locks to protect data for each sector
 static int clock_hand;               // keeps track of the index of the clock hand
+static struct lock flush_lock;       // serializes flush_slots()
+static uint8_t* flush_buffer;        // staging buffer for multi-sector writeback
+static bool warmup_reserved;         // does WARMUP_SECTOR hold a warm-up list?
+
+static void cache_warmup(void* warmup_);
 
 void cache_init(void) {
   lock_init(&global_cache_lock);
@@ -16,6 +41,10 @@ void cache_init(void) {
     lock_init(&sector_locks[i]);
   }
   clock_hand = 0;
+  lock_init(&flush_lock);
+  flush_buffer = malloc(64 * BLOCK_SECTOR_SIZE);
+  if (flush_buffer == NULL)
+    PANIC("couldn't allocate cache flush buffer");
 }
 
 void cache_read_at(struct block* block, block_sector_t sector, void* buffer, off_t size,
@@ -35,11 +64,13 @@ void cache_read_at(struct block* block, block_sector_t sector, void* buffer, off
       return;
     }
   }
-  clock_evict(fs_device, sector, buffer, 0, size, offset);
+  clock_evict(fs_device, sector, buffer, 0, size, offset, CACHE_NO_OWNER);
 }
 
+/* Writes SIZE bytes from BUFFER at OFFSET within SECTOR, marking
+   the cached sector dirty on behalf of the inode in sector OWNER. */
 void cache_write_at(struct block* block, block_sector_t sector, void* buffer, off_t size,
-                    off_t offset) {
+                    off_t offset, block_sector_t owner) {
   struct block* fs_device = block_get_role(BLOCK_FILESYS);
   if (fs_device != block) {
     block_write(block, sector, buffer);
@@ -50,41 +81,257 @@ void cache_write_at(struct block* block, block_sector_t sector, void* buffer, of
       lock_acquire(&sector_locks[i]);
       buffer_cache[i].dirty_bit = 1;
       buffer_cache[i].clock_bit = 1;
+      buffer_cache[i].owner = owner;
       void* buf = buffer_cache[i].buffer;
       memcpy(buf + offset, buffer, size);
       lock_release(&sector_locks[i]);
       return;
     }
   }
-  clock_evict(fs_device, sector, buffer, 1, size, offset);
+  clock_evict(fs_device, sector, buffer, 1, size, offset, owner);
 }
 
-void cache_write(struct block* block, block_sector_t sector, void* buffer) {
-  cache_write_at(block, sector, buffer, BLOCK_SECTOR_SIZE, 0);
+void cache_write(struct block* block, block_sector_t sector, void* buffer, block_sector_t owner) {
+  cache_write_at(block, sector, buffer, BLOCK_SECTOR_SIZE, 0, owner);
 }
 
 void cache_read(struct block* block, block_sector_t sector, void* buffer) {
   cache_read_at(block, sector, buffer, BLOCK_SECTOR_SIZE, 0);
 }
 
-void cache_flush(void) {
+/* Returns the slot that caches SECTOR, or -1 if SECTOR is not
+   cached. */
+static int cache_lookup(block_sector_t sector) {
+  for (int i = 0; i < 64; i++) {
+    if (sector == buffer_cache[i].sector && buffer_cache[i].valid == 1) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/* Reads a full SECTOR into BUFFER without caching it.  If the
+   sector is already cached, the cached copy is newer than the
+   disk and is used instead.  The global cache lock is held
+   across an uncached transfer so the sector cannot be brought
+   into the cache mid-transfer.  It is dropped before taking a
+   sector lock, to keep the lock order used by clock_evict(). */
+void cache_read_direct(struct block* block, block_sector_t sector, void* buffer) {
+  struct block* fs_device = block_get_role(BLOCK_FILESYS);
+  if (fs_device != block) {
+    block_read(block, sector, buffer);
+    return;
+  }
+  while (true) {
+    lock_acquire(&global_cache_lock);
+    int i = cache_lookup(sector);
+    if (i == -1) {
+      block_read(fs_device, sector, buffer);
+      lock_release(&global_cache_lock);
+      return;
+    }
+    lock_release(&global_cache_lock);
+
+    // Recheck under the sector lock in case the slot was evicted meanwhile
+    lock_acquire(&sector_locks[i]);
+    if (buffer_cache[i].sector == sector && buffer_cache[i].valid == 1) {
+      buffer_cache[i].clock_bit = 1;
+      memcpy(buffer, buffer_cache[i].buffer, BLOCK_SECTOR_SIZE);
+      lock_release(&sector_locks[i]);
+      return;
+    }
+    lock_release(&sector_locks[i]);
+  }
+}
+
+/* Writes a full SECTOR from BUFFER without caching it.  If the
+   sector is already cached, the cached copy is updated instead
+   so that later cached reads and writeback stay coherent.
+   Locking follows cache_read_direct(). */
+void cache_write_direct(struct block* block, block_sector_t sector, const void* buffer,
+                        block_sector_t owner) {
+  struct block* fs_device = block_get_role(BLOCK_FILESYS);
+  if (fs_device != block) {
+    block_write(block, sector, buffer);
+    return;
+  }
+  while (true) {
+    lock_acquire(&global_cache_lock);
+    int i = cache_lookup(sector);
+    if (i == -1) {
+      block_write(fs_device, sector, buffer);
+      lock_release(&global_cache_lock);
+      return;
+    }
+    lock_release(&global_cache_lock);
+
+    // Recheck under the sector lock in case the slot was evicted meanwhile
+    lock_acquire(&sector_locks[i]);
+    if (buffer_cache[i].sector == sector && buffer_cache[i].valid == 1) {
+      buffer_cache[i].dirty_bit = 1;
+      buffer_cache[i].clock_bit = 1;
+      buffer_cache[i].owner = owner;
+      memcpy(buffer_cache[i].buffer, buffer, BLOCK_SECTOR_SIZE);
+      lock_release(&sector_locks[i]);
+      return;
+    }
+    lock_release(&sector_locks[i]);
+  }
+}
+
+/* Writes zeros to the CNT sectors starting at SECTOR with
+   multi-sector writes that bypass the cache.  The sectors must be
+   freshly allocated, so no one reads them meanwhile.  Stale cached
+   copies are zeroed first, so their writeback can't undo this. */
+void cache_write_zeros(block_sector_t sector, block_sector_t cnt) {
+  struct block* fs_device = block_get_role(BLOCK_FILESYS);
+
+  for (int i = 0; i < 64; i++) {
+    lock_acquire(&sector_locks[i]);
+    if (buffer_cache[i].valid == 1 && buffer_cache[i].sector >= sector &&
+        buffer_cache[i].sector - sector < cnt) {
+      void* buf = buffer_cache[i].buffer;
+      memset(buf, 0, BLOCK_SECTOR_SIZE);
+    }
+    lock_release(&sector_locks[i]);
+  }
+
+  // Borrow the flush staging buffer, which holds 64 sectors
+  lock_acquire(&flush_lock);
+  memset(flush_buffer, 0, 64 * BLOCK_SECTOR_SIZE);
+  while (cnt > 0) {
+    block_sector_t chunk = cnt < 64 ? cnt : 64;
+    block_write_multiple(fs_device, sector, flush_buffer, chunk);
+    sector += chunk;
+    cnt -= chunk;
+  }
+  lock_release(&flush_lock);
+}
+
+/* A dirty slot picked for writeback, with the sector it held
+   when it was picked. */
+struct flush_item {
+  int slot;
+  block_sector_t sector;
+};
+
+/* Compares the sectors of the flush_items A and B. */
+static int compare_flush_items(const void* a_, const void* b_) {
+  const struct flush_item* a = a_;
+  const struct flush_item* b = b_;
+  return a->sector < b->sector ? -1 : a->sector > b->sector;
+}
+
+/* Writes the CNT sectors of the run starting at SECTOR, staged in
+   RUN, to disk, then marks the slots listed in SLOTS clean and
+   releases their sector locks. */
+static void flush_run(block_sector_t sector, const uint8_t* run, const int* slots, int cnt) {
   struct block* fs_device = block_get_role(BLOCK_FILESYS);
+  block_write_multiple(fs_device, sector, run, cnt);
+  for (int i = 0; i < cnt; i++) {
+    buffer_cache[slots[i]].dirty_bit = 0;
+    lock_release(&sector_locks[slots[i]]);
+  }
+}
+
+/* Writes back the dirty sectors owned by the inode in sector
+   OWNER, or every dirty sector if ALL is true.  Sectors are
+   written in ascending order, and each run of consecutive sectors
+   goes out as a single multi-sector transfer, so a flush is one
+   sweep across the disk.
+
+   The global cache lock is only held while picking slots.  Each
+   slot's sector lock is held from the time it is staged until
+   its run reaches the disk, so it cannot be evicted, and re-read
+   stale, in between.  Flushes are serialized by flush_lock, since
+   they hold several sector locks at once. */
+static void flush_slots(bool all, block_sector_t owner) {
+  struct flush_item items[64];
+  int slots[64];
+  int item_cnt = 0;
+  int run_cnt = 0;
+  block_sector_t run_start = 0;
+
+  lock_acquire(&flush_lock);
   lock_acquire(&global_cache_lock);
   for (int i = 0; i < 64; i++) {
-    if (buffer_cache[i].dirty_bit == 1) {
-      block_write(fs_device, buffer_cache[i].sector, buffer_cache[i].buffer);
+    if (buffer_cache[i].valid == 1 && buffer_cache[i].dirty_bit == 1 &&
+        (all || buffer_cache[i].owner == owner)) {
+      items[item_cnt].slot = i;
+      items[item_cnt].sector = buffer_cache[i].sector;
+      item_cnt++;
     }
   }
   lock_release(&global_cache_lock);
+  qsort(items, item_cnt, sizeof *items, compare_flush_items);
+
+  for (int i = 0; i < item_cnt; i++) {
+    struct cache_item* c = &buffer_cache[items[i].slot];
+
+    // Skip slots that were written back or reused since they were picked
+    lock_acquire(&sector_locks[items[i].slot]);
+    if (c->valid != 1 || c->dirty_bit != 1 || c->sector != items[i].sector) {
+      lock_release(&sector_locks[items[i].slot]);
+      continue;
+    }
+
+    if (run_cnt > 0 && c->sector != run_start + run_cnt) {
+      flush_run(run_start, flush_buffer, slots, run_cnt);
+      run_cnt = 0;
+    }
+    if (run_cnt == 0)
+      run_start = c->sector;
+    memcpy(flush_buffer + run_cnt * BLOCK_SECTOR_SIZE, c->buffer, BLOCK_SECTOR_SIZE);
+    slots[run_cnt++] = items[i].slot;
+  }
+  if (run_cnt > 0)
+    flush_run(run_start, flush_buffer, slots, run_cnt);
+  lock_release(&flush_lock);
+}
+
+/* Writes every dirty sector back to disk. */
+void cache_flush(void) { flush_slots(true, CACHE_NO_OWNER); }
+
+/* Writes back only the dirty sectors that writes to the inode in
+   sector OWNER left in the cache. */
+void cache_flush_inode(block_sector_t owner) { flush_slots(false, owner); }
+
+/* Writes back and then forgets every cached sector, so that the
+   next access to each one goes to the disk.  Sectors dirtied
+   again after the writeback stay cached. */
+void cache_drop(void) {
+  cache_flush();
+  for (int i = 0; i < 64; i++) {
+    lock_acquire(&sector_locks[i]);
+    lock_acquire(&global_cache_lock);
+    if (buffer_cache[i].dirty_bit == 0)
+      buffer_cache[i].valid = 0;
+    lock_release(&global_cache_lock);
+    lock_release(&sector_locks[i]);
+  }
 }
 
+/* Loads SECTOR into the slot the clock hand picks, writing back
+   the slot's old sector if it is dirty, then copies SIZE bytes at
+   OFFSET in the sector out to BUFFER or, if WRITE is nonzero, in
+   from BUFFER, marking the slot dirty on behalf of OWNER. */
 void clock_evict(struct block* fs_device, block_sector_t sector, void* buffer, int write,
-                 off_t size, off_t offset) {
+                 off_t size, off_t offset, block_sector_t owner) {
   while (true) {
     clock_hand += 1;
     int clock_index = clock_hand % 64;
     lock_acquire(&sector_locks[clock_index]);
     lock_acquire(&global_cache_lock);
+    if (cache_lookup(sector) != -1) {
+      // Another thread cached SECTOR while we waited, so use that copy
+      lock_release(&sector_locks[clock_index]);
+      lock_release(&global_cache_lock);
+      if (write)
+        cache_write_at(fs_device, sector, buffer, size, offset, owner);
+      else
+        cache_read_at(fs_device, sector, buffer, size, offset);
+      return;
+    }
     if (buffer_cache[clock_index].clock_bit == 0) {
       if (buffer_cache[clock_index].dirty_bit == 1) {
         block_write(fs_device, buffer_cache[clock_index].sector, buffer_cache[clock_index].buffer);
@@ -93,6 +340,7 @@ void clock_evict(struct block* fs_device, block_sector_t sector, void* buffer, i
         buffer_cache[clock_index].valid = 1;
         buffer_cache[clock_index].dirty_bit = 1;
         buffer_cache[clock_index].clock_bit = 1;
+        buffer_cache[clock_index].owner = owner;
         void* buf = buffer_cache[clock_index].buffer;
         block_read(fs_device, sector, buf);
         memcpy(buf + offset, buffer, size);
@@ -117,4 +365,93 @@ void clock_evict(struct block* fs_device, block_sector_t sector, void* buffer, i
     lock_release(&sector_locks[clock_index]);
     lock_release(&global_cache_lock);
   }
-}
\ No newline at end of file
+}
+
+/* Brings SECTOR into the cache, if it is not already there,
+   without copying it anywhere. */
+void cache_prefetch(block_sector_t sector) {
+  struct block* fs_device = block_get_role(BLOCK_FILESYS);
+  if (cache_lookup(sector) == -1)
+    clock_evict(fs_device, sector, NULL, 0, 0, 0, CACHE_NO_OWNER);
+}
+
+/* Saves the sectors currently in the cache to WARMUP_SECTOR, so
+   that the next boot can prefetch them.  Recently used sectors
+   are listed first.  Called at shutdown, after the cache has
+   been flushed.  Does nothing unless the file system was
+   formatted with WARMUP_SECTOR reserved for the list, since on
+   older disks that sector may hold file data. */
+void cache_warmup_save(void) {
+  struct block* fs_device = block_get_role(BLOCK_FILESYS);
+  if (!warmup_reserved)
+    return;
+  struct warmup_disk* warmup = calloc(1, sizeof *warmup);
+  if (warmup == NULL)
+    return;
+
+  ASSERT(sizeof *warmup == BLOCK_SECTOR_SIZE);
+  warmup->magic = WARMUP_MAGIC;
+  lock_acquire(&global_cache_lock);
+  for (int recent = 1; recent >= 0; recent--) {
+    for (int i = 0; i < 64 && warmup->cnt < WARMUP_MAX; i++) {
+      if (buffer_cache[i].valid == 1 && buffer_cache[i].clock_bit == recent)
+        warmup->sectors[warmup->cnt++] = buffer_cache[i].sector;
+    }
+  }
+  lock_release(&global_cache_lock);
+
+  block_write(fs_device, WARMUP_SECTOR, warmup);
+  free(warmup);
+}
+
+/* Writes an empty warm-up list to WARMUP_SECTOR, marking it as
+   reserved for the list.  Called when formatting. */
+void cache_warmup_format(void) {
+  struct block* fs_device = block_get_role(BLOCK_FILESYS);
+  struct warmup_disk* warmup = calloc(1, sizeof *warmup);
+  if (warmup == NULL)
+    PANIC("couldn't allocate warm-up list");
+
+  warmup->magic = WARMUP_MAGIC;
+  block_write(fs_device, WARMUP_SECTOR, warmup);
+  warmup_reserved = true;
+  free(warmup);
+}
+
+/* Reads the warm-up list saved by the previous shutdown and
+   starts a background thread that prefetches its sectors.  A
+   disk without a valid list in WARMUP_SECTOR predates the list,
+   so the sector is left alone from then on. */
+void cache_warmup_start(void) {
+  struct block* fs_device = block_get_role(BLOCK_FILESYS);
+  struct warmup_disk* warmup = malloc(sizeof *warmup);
+  if (warmup == NULL)
+    return;
+
+  block_read(fs_device, WARMUP_SECTOR, warmup);
+  warmup_reserved = warmup->magic == WARMUP_MAGIC;
+  if (!warmup_reserved || warmup->cnt == 0 || warmup->cnt > WARMUP_MAX ||
+      thread_create("cache-warmup", PRI_DEFAULT, cache_warmup, warmup) == TID_ERROR)
+    free(warmup);
+}
+
+/* Compares the sector numbers pointed to by A and B. */
+static int compare_sectors(const void* a_, const void* b_) {
+  const block_sector_t* a = a_;
+  const block_sector_t* b = b_;
+  return *a < *b ? -1 : *a > *b;
+}
+
+/* Warm-up thread.  Prefetches the sectors in WARMUP_ in
+   ascending order, so the disk sees one sequential sweep. */
+static void cache_warmup(void* warmup_) {
+  struct warmup_disk* warmup = warmup_;
+  struct block* fs_device = block_get_role(BLOCK_FILESYS);
+
+  qsort(warmup->sectors, warmup->cnt, sizeof *warmup->sectors, compare_sectors);
+  for (uint32_t i = 0; i < warmup->cnt; i++) {
+    if (warmup->sectors[i] < block_size(fs_device))
+      cache_prefetch(warmup->sectors[i]);
+  }
+  free(warmup);
+}
@@ -8,14 +8,28 @@ struct cache_item {
   int buffer
       [BLOCK_SECTOR_SIZE]; // buffer that contains data of the cache item; replacement for the bounce buffer
   block_sector_t sector; // sector number of disk location
+  block_sector_t owner;  // inode sector whose write dirtied this item, for cache_flush_inode()
 };
 
+/* Owner of dirty cache items that belong to no inode. */
+#define CACHE_NO_OWNER ((block_sector_t)-1)
+
 void cache_init(void);
-void cache_write(struct block* block, block_sector_t sector, void* buffer);
+void cache_write(struct block* block, block_sector_t sector, void* buffer, block_sector_t owner);
 void cache_write_at(struct block* block, block_sector_t sector, void* buffer, off_t size,
-                    off_t offset);
+                    off_t offset, block_sector_t owner);
 void cache_read(struct block* block, block_sector_t sector, void* buffer);
 void cache_read_at(struct block* block, block_sector_t sector, void* buffer, off_t size,
                    off_t offset);
+void cache_read_direct(struct block* block, block_sector_t sector, void* buffer);
+void cache_write_direct(struct block* block, block_sector_t sector, const void* buffer,
+                        block_sector_t owner);
+void cache_write_zeros(block_sector_t sector, block_sector_t cnt);
 void cache_flush(void);
-void clock_evict(struct block*, block_sector_t, void*, int, off_t, off_t);
\ No newline at end of file
+void cache_flush_inode(block_sector_t owner);
+void cache_drop(void);
+void cache_prefetch(block_sector_t sector);
+void cache_warmup_format(void);
+void cache_warmup_save(void);
+void cache_warmup_start(void);
+void clock_evict(struct block*, block_sector_t, void*, int, off_t, off_t, block_sector_t);
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "filesys/compress.h"
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+
+/* LZSS compression for file chunks.
+
+   A compressed stream is a sequence of groups, each a flag byte
+   followed by up to 8 items.  Bit I of the flag byte, counting
+   from the least significant bit, is 1 if item I is a match and
+   0 if it is a literal.  A literal is one byte that is copied to
+   the output.  A match is two bytes holding a 12-bit distance
+   minus 1 and a 4-bit length minus MIN_MATCH, and copies that
+   many bytes starting that far back in the output. */
+
+/* Farthest back a match may start. */
+#define WINDOW_SIZE 4096
+
+/* Shortest and longest matches. */
+#define MIN_MATCH 3
+#define MAX_MATCH (MIN_MATCH + 15)
+
+/* The compressor finds matches through a table of the last
+   position where each hash of MIN_MATCH bytes was seen. */
+#define HASH_BITS 10
+#define HASH_SIZE (1 << HASH_BITS)
+#define NO_POS 0xffff
+
+/* Returns the hash of the MIN_MATCH bytes at P. */
+static inline unsigned hash(const uint8_t* p) {
+  return ((p[0] << 8 ^ p[1] << 4 ^ p[2]) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Compresses the SIZE bytes at SRC into DST, which has room for
+   DST_SIZE bytes.  SIZE must not exceed 65535.  Returns the size
+   of the compressed stream, or 0 if it doesn't fit in DST_SIZE
+   bytes or memory is short. */
+size_t compress_chunk(const void* src_, size_t size, void* dst_, size_t dst_size) {
+  const uint8_t* src = src_;
+  uint8_t* dst = dst_;
+  size_t in = 0, out = 0, flag_pos = 0;
+  int item = 8;
+
+  uint16_t* table = malloc(HASH_SIZE * sizeof *table);
+  if (table == NULL)
+    return 0;
+  memset(table, 0xff, HASH_SIZE * sizeof *table);
+
+  while (in < size) {
+    // Start a new group
+    if (item == 8) {
+      if (out >= dst_size)
+        goto fail;
+      flag_pos = out++;
+      dst[flag_pos] = 0;
+      item = 0;
+    }
+
+    // Look for an earlier occurrence of the next bytes
+    size_t len = 0, dist = 0;
+    if (in + MIN_MATCH <= size) {
+      unsigned h = hash(src + in);
+      size_t cand = table[h];
+      table[h] = in;
+      if (cand != NO_POS && in - cand <= WINDOW_SIZE) {
+        size_t max = size - in < MAX_MATCH ? size - in : MAX_MATCH;
+        while (len < max && src[cand + len] == src[in + len])
+          len++;
+        dist = in - cand;
+      }
+    }
+
+    if (len >= MIN_MATCH) {
+      if (out + 2 > dst_size)
+        goto fail;
+      dst[flag_pos] |= 1 << item;
+      dst[out++] = (dist - 1) & 0xff;
+      dst[out++] = ((dist - 1) >> 8) << 4 | (len - MIN_MATCH);
+      for (size_t i = 1; i < len && in + i + MIN_MATCH <= size; i++)
+        table[hash(src + in + i)] = in + i;
+      in += len;
+    } else {
+      if (out >= dst_size)
+        goto fail;
+      dst[out++] = src[in++];
+    }
+    item++;
+  }
+  free(table);
+  return out;
+
+fail:
+  free(table);
+  return 0;
+}
+
+/* Decompresses the SRC_SIZE-byte stream at SRC into exactly
+   DST_SIZE bytes at DST.  Returns false if the stream is
+   corrupt or too short. */
+bool decompress_chunk(const void* src_, size_t src_size, void* dst_, size_t dst_size) {
+  const uint8_t* src = src_;
+  uint8_t* dst = dst_;
+  size_t in = 0, out = 0;
+
+  while (out < dst_size) {
+    if (in >= src_size)
+      return false;
+    uint8_t flags = src[in++];
+    for (int item = 0; item < 8 && out < dst_size; item++) {
+      if (flags & (1 << item)) {
+        if (in + 2 > src_size)
+          return false;
+        size_t dist = (src[in] | (src[in + 1] >> 4) << 8) + 1;
+        size_t len = (src[in + 1] & 0xf) + MIN_MATCH;
+        in += 2;
+        if (dist > out || len > dst_size - out)
+          return false;
+        // Byte at a time, since a match may overlap its own output
+        for (; len > 0; len--, out++)
+          dst[out] = dst[out - dist];
+      } else {
+        if (in >= src_size)
+          return false;
+        dst[out++] = src[in++];
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,10 @@
+#ifndef FILESYS_COMPRESS_H
+#define FILESYS_COMPRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+size_t compress_chunk(const void* src, size_t size, void* dst, size_t dst_size);
+bool decompress_chunk(const void* src, size_t src_size, void* dst, size_t dst_size);
+
+#endif /* filesys/compress.h */
@@ -4,10 +4,23 @@
 #include <list.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #include "userprog/process.h"
 
+/* Number of directory entries dir_readdir_batch() reads from
+   disk per inode_read_at() call. */
+#define DIR_BATCH_CNT 16
+
+/* Cache that open directories are allocated from. */
+static struct slab_cache* dir_cache;
+
+/* Clears a newly allocated directory. */
+static void dir_ctor(void* dir) { memset(dir, 0, sizeof(struct dir)); }
+
+/* Initializes the directory module. */
+void dir_init(void) { dir_cache = slab_cache_create("dir", sizeof(struct dir), dir_ctor); }
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool dir_create(block_sector_t sector, size_t entry_cnt, block_sector_t parent_sector) {
@@ -31,14 +44,14 @@ bool dir_create(block_sector_t sector, size_t entry_cnt, block_sector_t parent_s
 /* Opens and returns the directory for the given INODE, of which
    it takes ownership.  Returns a null pointer on failure. */
 struct dir* dir_open(struct inode* inode) {
-  struct dir* dir = calloc(1, sizeof *dir);
+  struct dir* dir = slab_alloc(dir_cache);
   if (inode != NULL && dir != NULL) {
     dir->inode = inode;
     dir->pos = 0;
     return dir;
   } else {
     inode_close(inode);
-    free(dir);
+    slab_free(dir_cache, dir);
     return NULL;
   }
 }
@@ -59,7 +72,7 @@ struct dir* dir_reopen(struct dir* dir) {
 void dir_close(struct dir* dir) {
   if (dir != NULL) {
     inode_close(dir->inode);
-    free(dir);
+    slab_free(dir_cache, dir);
   }
 }
 
@@ -204,4 +217,42 @@ bool dir_readdir(struct dir* dir, char name[NAME_MAX + 1]) {
     }
   }
   return false;
-}
\ No newline at end of file
+}
+/* Reads up to CNT entries from DIR, starting at its current
+   position, into ENTRIES.  Each entry carries its inode number,
+   type and length, read straight from the entry's on-disk inode
+   so that callers need not open every file.  "." and ".." are
+   skipped, as in dir_readdir().  Returns the number of entries
+   stored, which is 0 once DIR has no more entries. */
+size_t dir_readdir_batch(struct dir* dir, struct dirent* entries, size_t cnt) {
+  struct dir_entry buf[DIR_BATCH_CNT];
+  off_t length = inode_disk_length(dir->inode);
+  size_t filled = 0;
+
+  while (filled < cnt && dir->pos + (off_t)sizeof *buf <= length) {
+    /* Read as many whole entries as fit in BUF in one call. */
+    size_t read_cnt = (length - dir->pos) / sizeof *buf;
+    if (read_cnt > DIR_BATCH_CNT)
+      read_cnt = DIR_BATCH_CNT;
+    if (inode_read_at(dir->inode, buf, read_cnt * sizeof *buf, dir->pos) !=
+        (off_t)(read_cnt * sizeof *buf))
+      break;
+
+    for (size_t i = 0; i < read_cnt && filled < cnt; i++) {
+      struct dir_entry* e = &buf[i];
+      dir->pos += sizeof *e;
+      if (!e->in_use || !strcmp(e->name, ".") || !strcmp(e->name, ".."))
+        continue;
+
+      struct dirent* d = &entries[filled++];
+      off_t file_length;
+      bool isdir;
+      inode_stat(e->inode_sector, &file_length, &isdir);
+      d->inumber = e->inode_sector;
+      d->length = file_length;
+      d->isdir = isdir;
+      strlcpy(d->name, e->name, sizeof d->name);
+    }
+  }
+  return filled;
+}
@@ -5,6 +5,7 @@
 #include <stddef.h>
 #include "devices/block.h"
 #include "filesys/filesys.h"
+#include <dirent.h>
 
 /* Maximum length of a file name component.
    This is the traditional UNIX maximum length.
@@ -28,6 +29,7 @@ struct dir_entry {
 };
 
 /* Opening and closing directories. */
+void dir_init(void);
 bool dir_create(block_sector_t sector, size_t entry_cnt, block_sector_t parent_sector);
 struct dir* dir_open(struct inode*);
 struct dir* dir_open_root(void);
@@ -40,5 +42,6 @@ bool dir_lookup(const struct dir*, const char* name, struct inode**);
 bool dir_add(struct dir*, const char* name, block_sector_t);
 bool dir_remove(struct dir*, const char* name);
 bool dir_readdir(struct dir*, char name[NAME_MAX + 1]);
+size_t dir_readdir_batch(struct dir*, struct dirent*, size_t cnt);
 
 #endif /* filesys/directory.h */
\ No newline at end of file
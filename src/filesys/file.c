@@ -1,13 +1,23 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include <string.h>
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
+
+/* Cache that open files are allocated from. */
+static struct slab_cache* file_cache;
+
+/* Clears a newly allocated file. */
+static void file_ctor(void* file) { memset(file, 0, sizeof(struct file)); }
+
+/* Initializes the file module. */
+void file_init(void) { file_cache = slab_cache_create("file", sizeof(struct file), file_ctor); }
 
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
 struct file* file_open(struct inode* inode) {
-  struct file* file = calloc(1, sizeof *file);
+  struct file* file = slab_alloc(file_cache);
   if (inode != NULL && file != NULL) {
     file->inode = inode;
     file->pos = 0;
@@ -15,7 +25,7 @@ struct file* file_open(struct inode* inode) {
     return file;
   } else {
     inode_close(inode);
-    free(file);
+    slab_free(file_cache, file);
     return NULL;
   }
 }
@@ -31,7 +41,7 @@ void file_close(struct file* file) {
   if (file != NULL) {
     file_allow_write(file);
     inode_close(file->inode);
-    free(file);
+    slab_free(file_cache, file);
   }
 }
 
@@ -66,8 +76,16 @@ off_t file_read_at(struct file* file, void* buffer, off_t size, off_t file_ofs)
    which may be less than SIZE if end of file is reached.
    (Normally we'd grow the file in that case, but file growth is
    not yet implemented.)
+   In append mode, writes at the end of file instead.
    Advances FILE's position by the number of bytes read. */
 off_t file_write(struct file* file, const void* buffer, off_t size) {
+  if (file->append) {
+    off_t offset;
+    off_t bytes_written = inode_append(file->inode, buffer, size, &offset);
+    if (bytes_written > 0)
+      file->pos = offset + bytes_written;
+    return bytes_written;
+  }
   off_t bytes_written = inode_write_at(file->inode, buffer, size, file->pos);
   file->pos += bytes_written;
   return bytes_written;
@@ -84,6 +102,14 @@ off_t file_write_at(struct file* file, const void* buffer, off_t size, off_t fil
   return inode_write_at(file->inode, buffer, size, file_ofs);
 }
 
+/* Puts FILE in append mode if APPEND is true, so that each
+   file_write() atomically goes to the end of file, or takes it
+   out of append mode otherwise. */
+void file_set_append(struct file* file, bool append) {
+  ASSERT(file != NULL);
+  file->append = append;
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void file_deny_write(struct file* file) {
@@ -12,9 +12,11 @@ struct file {
   struct inode* inode; /* File's inode. */
   off_t pos;           /* Current position. */
   bool deny_write;     /* Has file_deny_write() been called? */
+  bool append;         /* Do writes always go to the end of file? */
 };
 
 /* Opening and closing files. */
+void file_init(void);
 struct file* file_open(struct inode*);
 struct file* file_reopen(struct file*);
 void file_close(struct file*);
@@ -26,6 +28,9 @@ off_t file_read_at(struct file*, void*, off_t size, off_t start);
 off_t file_write(struct file*, const void*, off_t);
 off_t file_write_at(struct file*, const void*, off_t size, off_t start);
 
+/* Append mode. */
+void file_set_append(struct file*, bool);
+
 /* Preventing writes. */
 void file_deny_write(struct file*);
 void file_allow_write(struct file*);
@@ -29,6 +29,8 @@ void filesys_init(bool format) {
     PANIC("No file system device found, can't initialize file system.");
 
   inode_init();
+  file_init();
+  dir_init();
   free_map_init();
   cache_init();
 
@@ -36,13 +38,32 @@ void filesys_init(bool format) {
     do_format();
 
   free_map_open();
+
+  /* Prefetch the sectors that were hot at the last shutdown. */
+  if (!format)
+    cache_warmup_start();
 }
 
 /* Shuts down the file system module, writing any unwritten data
    to disk. */
 void filesys_done(void) {
+  inode_done();
   free_map_close();
   cache_flush();
+  cache_warmup_save();
+}
+
+/* Writes all dirty cached file system data to disk. */
+void filesys_sync(void) { cache_flush(); }
+
+/* Fills in ST with the file system's space usage. */
+void filesys_statfs(struct statfs* st) {
+  size_t total, free;
+
+  free_map_stat(&total, &free);
+  st->sector_size = BLOCK_SECTOR_SIZE;
+  st->total_sectors = total;
+  st->free_sectors = free;
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -84,7 +105,7 @@ bool filesys_create(const char* name, off_t initial_size, int isdir) {
     struct inode* parent_inode = dir_get_inode(parent_dir);
     struct inode_disk* id = get_inode_disk(parent_inode);
     id->files_rem += 1;
-    cache_write(fs_device, parent_inode->sector, id);
+    cache_write(fs_device, parent_inode->sector, id, parent_inode->sector);
     free(id);
   }
 
@@ -174,7 +195,7 @@ bool filesys_remove(const char* name) {
 
         // decrement parent file count and save back to disk
         parent_id->files_rem -= 1;
-        cache_write(fs_device, parent_dir->inode->sector, parent_id);
+        cache_write(fs_device, parent_dir->inode->sector, parent_id, parent_dir->inode->sector);
         free(parent_id);
 
         // remove dir from parent dir
@@ -189,7 +210,7 @@ bool filesys_remove(const char* name) {
     else {
       // decrement parent file count and save back to disk
       parent_id->files_rem -= 1;
-      cache_write(fs_device, parent_dir->inode->sector, parent_id);
+      cache_write(fs_device, parent_dir->inode->sector, parent_id, parent_dir->inode->sector);
       free(parent_id);
 
       bool success = dir_remove(parent_dir, name_part);
@@ -231,6 +252,7 @@ bool filesys_chdir(const char* dir_name) {
 static void do_format(void) {
   printf("Formatting file system...");
   free_map_create();
+  cache_warmup_format();
   // not sure about the third param for this call
   if (!dir_create(ROOT_DIR_SECTOR, 16, ROOT_DIR_SECTOR))
     PANIC("root directory creation failed");
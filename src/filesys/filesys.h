@@ -2,17 +2,21 @@
 #define FILESYS_FILESYS_H
 
 #include <stdbool.h>
+#include <statfs.h>
 #include "filesys/off_t.h"
 
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0 /* Free map file inode sector. */
 #define ROOT_DIR_SECTOR 1 /* Root directory file inode sector. */
+#define WARMUP_SECTOR 2   /* Cache warm-up list, stored raw. */
 
 /* Block device that contains the file system. */
 extern struct block* fs_device;
 
 void filesys_init(bool format);
 void filesys_done(void);
+void filesys_sync(void);
+void filesys_statfs(struct statfs* st);
 bool filesys_create(const char* name, off_t initial_size, int isdir);
 struct file* filesys_open(const char* name);
 struct dir* filesys_open_dir(const char* name);
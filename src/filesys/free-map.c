@@ -1,20 +1,149 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
 
 static struct file* free_map_file; /* Free map file. */
 static struct bitmap* free_map;    /* Free map, one bit per sector. */
+static struct lock free_map_lock;  /* Serializes free map updates. */
+
+/* The free map is indexed by chunks of FREE_CHUNK_SECTORS
+   sectors, so that allocation can skip chunks that can't hold the
+   request and free space can be reported without counting bits. */
+#define FREE_CHUNK_SECTORS 1024
+
+/* Free space summary of one chunk. */
+struct free_chunk {
+  uint16_t free_cnt; /* Number of free sectors in the chunk. */
+  uint16_t largest;  /* Upper bound on the longest free run inside the chunk. */
+};
+
+static struct free_chunk* chunks; /* One entry per chunk. */
+static size_t chunk_cnt;          /* Number of chunks. */
+static size_t free_total;         /* Number of free sectors. */
+static size_t cursor;             /* Chunk where the next search starts. */
+
+static void free_map_index(void);
 
 /* Initializes the free map. */
 void free_map_init(void) {
+  lock_init(&free_map_lock);
   free_map = bitmap_create(block_size(fs_device));
   if (free_map == NULL)
     PANIC("bitmap creation failed--file system device is too large");
+  chunk_cnt = DIV_ROUND_UP(bitmap_size(free_map), FREE_CHUNK_SECTORS);
+  chunks = malloc(chunk_cnt * sizeof *chunks);
+  if (chunks == NULL)
+    PANIC("free map index creation failed");
   bitmap_mark(free_map, FREE_MAP_SECTOR);
   bitmap_mark(free_map, ROOT_DIR_SECTOR);
+  bitmap_mark(free_map, WARMUP_SECTOR);
+  free_map_index();
+}
+
+/* Returns the number of sectors in chunk IDX. */
+static size_t chunk_size(size_t idx) {
+  size_t start = idx * FREE_CHUNK_SECTORS;
+  size_t end = bitmap_size(free_map);
+  return end - start < FREE_CHUNK_SECTORS ? end - start : FREE_CHUNK_SECTORS;
+}
+
+/* Rebuilds the free space index from the free map. */
+static void free_map_index(void) {
+  free_total = 0;
+  cursor = 0;
+  for (size_t i = 0; i < chunk_cnt; i++) {
+    chunks[i].free_cnt = bitmap_count(free_map, i * FREE_CHUNK_SECTORS, chunk_size(i), false);
+    chunks[i].largest = chunks[i].free_cnt;
+    free_total += chunks[i].free_cnt;
+  }
+}
+
+/* Marks the CNT sectors starting at START as used, if USED is
+   true, or free, and updates the index to match.  Each sector
+   must be in the opposite state beforehand. */
+static void mark_range(size_t start, size_t cnt, bool used) {
+  bitmap_set_multiple(free_map, start, cnt, used);
+  while (cnt > 0) {
+    struct free_chunk* c = &chunks[start / FREE_CHUNK_SECTORS];
+    size_t n = FREE_CHUNK_SECTORS - start % FREE_CHUNK_SECTORS;
+    if (n > cnt)
+      n = cnt;
+    if (used) {
+      c->free_cnt -= n;
+      free_total -= n;
+      if (c->largest > c->free_cnt)
+        c->largest = c->free_cnt;
+    } else {
+      // Freed sectors may join runs on either side, so loosen the bound
+      c->free_cnt += n;
+      free_total += n;
+      c->largest = c->free_cnt;
+    }
+    start += n;
+    cnt -= n;
+  }
+}
+
+/* Returns the first sector of the first run of CNT free sectors
+   that starts in chunk IDX, or BITMAP_ERROR if there is none.
+   The run may extend into the chunks after IDX.  Tightens the
+   chunk's largest run bound as a side effect. */
+static size_t scan_chunk(size_t idx, size_t cnt) {
+  size_t start = idx * FREE_CHUNK_SECTORS;
+  size_t end = start + chunk_size(idx);
+  size_t run = 0, longest = 0;
+
+  for (size_t i = start; i < bitmap_size(free_map); i++) {
+    if (bitmap_test(free_map, i)) {
+      if (i >= end)
+        break;
+      run = 0;
+      continue;
+    }
+    if (++run == cnt)
+      return i + 1 - cnt;
+    if (i < end && run > longest)
+      longest = run;
+  }
+  // A run that ran into the next chunk doesn't fit inside this one
+  chunks[idx].largest = longest;
+  return BITMAP_ERROR;
+}
+
+/* Returns the first sector of a run of CNT free sectors, searching
+   from the chunk after the last allocation and wrapping around,
+   or BITMAP_ERROR if there is none.  Chunks whose free space is
+   too small to start the run are skipped without being scanned. */
+static size_t find_run(size_t cnt) {
+  if (cnt > free_total)
+    return BITMAP_ERROR;
+
+  for (size_t n = 0; n < chunk_cnt; n++) {
+    size_t idx = (cursor + n) % chunk_cnt;
+    struct free_chunk* c = &chunks[idx];
+
+    // A run no longer than a chunk that starts here ends here or in the next chunk
+    if (c->free_cnt == 0)
+      continue;
+    if (cnt <= FREE_CHUNK_SECTORS) {
+      size_t next_free = idx + 1 < chunk_cnt ? chunks[idx + 1].free_cnt : 0;
+      if (c->largest + next_free < cnt)
+        continue;
+    }
+
+    size_t sector = scan_chunk(idx, cnt);
+    if (sector != BITMAP_ERROR) {
+      cursor = (sector + cnt) / FREE_CHUNK_SECTORS % chunk_cnt;
+      return sector;
+    }
+  }
+  return BITMAP_ERROR;
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -23,11 +152,15 @@ void free_map_init(void) {
    sectors were available or if the free_map file could not be
    written. */
 bool free_map_allocate(size_t cnt, block_sector_t* sectorp) {
-  block_sector_t sector = bitmap_scan_and_flip(free_map, 0, cnt, false);
+  lock_acquire(&free_map_lock);
+  block_sector_t sector = find_run(cnt);
+  if (sector != BITMAP_ERROR)
+    mark_range(sector, cnt, true);
   if (sector != BITMAP_ERROR && free_map_file != NULL && !bitmap_write(free_map, free_map_file)) {
-    bitmap_set_multiple(free_map, sector, cnt, false);
+    mark_range(sector, cnt, false);
     sector = BITMAP_ERROR;
   }
+  lock_release(&free_map_lock);
   if (sector != BITMAP_ERROR)
     *sectorp = sector;
   return sector != BITMAP_ERROR;
@@ -35,9 +168,34 @@ bool free_map_allocate(size_t cnt, block_sector_t* sectorp) {
 
 /* Makes CNT sectors starting at SECTOR available for use. */
 void free_map_release(block_sector_t sector, size_t cnt) {
+  lock_acquire(&free_map_lock);
   ASSERT(bitmap_all(free_map, sector, cnt));
-  bitmap_set_multiple(free_map, sector, cnt, false);
+  mark_range(sector, cnt, false);
   bitmap_write(free_map, free_map_file);
+  lock_release(&free_map_lock);
+}
+
+/* Makes the CNT sectors listed in SECTORS available for use,
+   writing the free map to disk once for the whole batch. */
+void free_map_release_batch(const block_sector_t* sectors, size_t cnt) {
+  if (cnt == 0)
+    return;
+  lock_acquire(&free_map_lock);
+  for (size_t i = 0; i < cnt; i++) {
+    ASSERT(bitmap_test(free_map, sectors[i]));
+    mark_range(sectors[i], 1, false);
+  }
+  bitmap_write(free_map, free_map_file);
+  lock_release(&free_map_lock);
+}
+
+/* Stores the number of sectors the free map covers into *TOTAL
+   and the number of them that are free into *FREE. */
+void free_map_stat(size_t* total, size_t* free) {
+  lock_acquire(&free_map_lock);
+  *total = bitmap_size(free_map);
+  *free = free_total;
+  lock_release(&free_map_lock);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -47,6 +205,7 @@ void free_map_open(void) {
     PANIC("can't open free map");
   if (!bitmap_read(free_map, free_map_file))
     PANIC("can't read free map");
+  free_map_index();
 }
 
 /* Writes the free map to disk and closes the free map file. */
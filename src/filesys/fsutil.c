@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,19 +12,35 @@
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 #include "filesys/cache.h"
+#include "filesys/inode.h"
+#include "devices/timer.h"
+
+/* Number of directory entries fsutil_ls() fetches at a time. */
+#define FSUTIL_LS_BATCH 32
 
 /* List files in the root directory. */
 void fsutil_ls(char** argv UNUSED) {
   struct dir* dir;
-  char name[NAME_MAX + 1];
+  struct dirent* entries;
+  size_t cnt, i;
+
+  entries = malloc(FSUTIL_LS_BATCH * sizeof *entries);
+  if (entries == NULL)
+    PANIC("couldn't allocate directory entries");
 
   printf("Files in the root directory:\n");
   dir = dir_open_root();
   if (dir == NULL)
     PANIC("root dir open failed");
-  while (dir_readdir(dir, name))
-    printf("%s\n", name);
+  while ((cnt = dir_readdir_batch(dir, entries, FSUTIL_LS_BATCH)) > 0)
+    for (i = 0; i < cnt; i++) {
+      if (entries[i].isdir)
+        printf("%s (directory)\n", entries[i].name);
+      else
+        printf("%s (%d bytes)\n", entries[i].name, entries[i].length);
+    }
   dir_close(dir);
+  free(entries);
   printf("End of listing.\n");
 }
 
@@ -61,6 +78,24 @@ void fsutil_rm(char** argv) {
     PANIC("%s: delete failed\n", file_name);
 }
 
+/* Moves the data blocks of file ARGV[1] into one contiguous run
+   and prints how many extents it was in before and after. */
+void fsutil_defrag(char** argv) {
+  const char* file_name = argv[1];
+  struct file* file;
+  int before, after;
+
+  printf("Defragmenting '%s'...\n", file_name);
+  file = filesys_open(file_name);
+  if (file == NULL)
+    PANIC("%s: open failed", file_name);
+  if (!inode_defrag(file_get_inode(file), &before, &after))
+    printf("%s: defragment failed\n", file_name);
+  else
+    printf("%s: %d extents before, %d after\n", file_name, before, after);
+  file_close(file);
+}
+
 /* Extracts a ustar-format tar archive from the scratch block
    device into the Pintos file system. */
 void fsutil_extract(char** argv UNUSED) {
@@ -133,8 +168,8 @@ void fsutil_extract(char** argv UNUSED) {
   printf("Erasing ustar archive...\n");
   memset(header, 0, BLOCK_SECTOR_SIZE);
 
-  cache_write(src, 0, header);
-  cache_write(src, 1, header);
+  cache_write(src, 0, header, CACHE_NO_OWNER);
+  cache_write(src, 1, header, CACHE_NO_OWNER);
 
   free(data);
   free(header);
@@ -178,7 +213,7 @@ void fsutil_append(char** argv) {
   /* Write ustar header to first sector. */
   if (!ustar_make_header(file_name, USTAR_REGULAR, size, buffer))
     PANIC("%s: name too long for ustar format", file_name);
-  cache_write(dst, sector++, buffer);
+  cache_write(dst, sector++, buffer, CACHE_NO_OWNER);
 
   /* Do copy. */
   while (size > 0) {
@@ -188,7 +223,7 @@ void fsutil_append(char** argv) {
     if (file_read(src, buffer, chunk_size) != chunk_size)
       PANIC("%s: read failed with %" PROTd " bytes unread", file_name, size);
     memset(buffer + chunk_size, 0, BLOCK_SECTOR_SIZE - chunk_size);
-    cache_write(dst, sector++, buffer);
+    cache_write(dst, sector++, buffer, CACHE_NO_OWNER);
     size -= chunk_size;
   }
 
@@ -197,10 +232,73 @@ void fsutil_append(char** argv) {
      them, though, in case we have more files to append. */
   memset(buffer, 0, BLOCK_SECTOR_SIZE);
 
-  cache_write(dst, sector, buffer);
-  cache_write(dst, sector + 1, buffer);
+  cache_write(dst, sector, buffer, CACHE_NO_OWNER);
+  cache_write(dst, sector + 1, buffer, CACHE_NO_OWNER);
 
   /* Finish up. */
   file_close(src);
   free(buffer);
 }
+
+/* Size of each file fsutil_compress_bench() reads back. */
+#define BENCH_FILE_SIZE (256 * 1024)
+
+/* Writes the same text file twice, raw and in compress mode,
+   empties the buffer cache, and reports how many sectors and
+   timer ticks reading each one back takes. */
+void fsutil_compress_bench(char** argv UNUSED) {
+  static const char* names[] = {"bench-raw", "bench-compressed"};
+  struct block* fs_device = block_get_role(BLOCK_FILESYS);
+  char* data;
+  char* buffer;
+  off_t ofs;
+  int i;
+
+  data = malloc(BENCH_FILE_SIZE);
+  if (data == NULL)
+    PANIC("couldn't allocate benchmark data");
+  buffer = palloc_get_page(PAL_ASSERT);
+
+  /* Log-style text, which compresses about as well as typical
+     cold data. */
+  for (ofs = 0, i = 0; ofs < BENCH_FILE_SIZE; i++)
+    ofs += snprintf(data + ofs, BENCH_FILE_SIZE - ofs, "%08d: status ok, %d requests served\n", i,
+                    i * 7 % 1000);
+
+  for (i = 0; i < 2; i++) {
+    struct file* file;
+    unsigned long long reads;
+    int64_t start;
+
+    if (!filesys_create(names[i], 0, false))
+      PANIC("%s: create failed", names[i]);
+    file = filesys_open(names[i]);
+    if (file == NULL)
+      PANIC("%s: open failed", names[i]);
+    if (i == 1 && !inode_set_compress(file_get_inode(file), true))
+      PANIC("%s: couldn't turn on compress mode", names[i]);
+    if (file_write(file, data, BENCH_FILE_SIZE) != BENCH_FILE_SIZE)
+      PANIC("%s: write failed", names[i]);
+    file_close(file);
+    cache_drop();
+
+    reads = block_read_cnt(fs_device);
+    start = timer_ticks();
+    file = filesys_open(names[i]);
+    if (file == NULL)
+      PANIC("%s: reopen failed", names[i]);
+    for (ofs = 0; ofs < BENCH_FILE_SIZE; ofs += PGSIZE) {
+      if (file_read(file, buffer, PGSIZE) != PGSIZE)
+        PANIC("%s: read failed", names[i]);
+      if (memcmp(buffer, data + ofs, PGSIZE))
+        PANIC("%s: data differs at offset %" PROTd, names[i], ofs);
+    }
+    file_close(file);
+    printf("%s: %d bytes, %llu sectors read, %" PRId64 " ticks\n", names[i], BENCH_FILE_SIZE,
+           block_read_cnt(fs_device) - reads, timer_elapsed(start));
+    filesys_remove(names[i]);
+  }
+
+  palloc_free_page(buffer);
+  free(data);
+}
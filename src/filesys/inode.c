@@ -6,8 +6,11 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "filesys/cache.h"
+#include "filesys/compress.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -15,10 +18,38 @@
 /* ADDED: Number of pointers in buffers for indirect and doubly_indirect */
 #define NUM_INDIRECT 128
 
+/* Reads and writes of at least this many bytes move their whole,
+   aligned sectors straight between the disk and the caller's
+   buffer instead of through the buffer cache, so that large
+   sequential transfers don't evict cached metadata.  Only the data
+   of regular files goes direct; see use_direct_io(). */
+#define DIRECT_IO_MIN (8 * BLOCK_SECTOR_SIZE)
+
 /* Returns the number of sectors to allocate for an inode SIZE
    bytes long. */
 static inline size_t bytes_to_sectors(off_t size) { return DIV_ROUND_UP(size, BLOCK_SECTOR_SIZE); }
 
+/* Most data blocks an inode can address. */
+#define MAX_FILE_SECTORS (TOTAL_DIRECT + NUM_INDIRECT + NUM_INDIRECT * NUM_INDIRECT)
+
+/* Files in compress mode are split into chunks of
+   COMPRESS_CHUNK_SECTORS sectors.  When the last opener closes
+   such a file, each full chunk that compresses into fewer sectors
+   is rewritten as a compressed stream at the start of its first
+   sector, and its other sectors are freed, so a full chunk whose
+   last block is a hole is compressed.  Reads decompress a chunk
+   into the inode's chunk buffer.  Anything that changes the file
+   expands all of its chunks first. */
+#define COMPRESS_CHUNK_SECTORS 8
+#define COMPRESS_CHUNK_SIZE (COMPRESS_CHUNK_SECTORS * BLOCK_SECTOR_SIZE)
+
+/* Bytes before the stream in a compressed chunk, which hold the
+   stream's size. */
+#define CHUNK_HEADER_SIZE sizeof(uint32_t)
+
+/* Largest compressed stream worth storing. */
+#define CHUNK_STREAM_MAX ((COMPRESS_CHUNK_SECTORS - 1) * BLOCK_SECTOR_SIZE - CHUNK_HEADER_SIZE)
+
 /* Lock to synchronize open_inodes list. */
 static struct lock open_inodes_lock;
 
@@ -26,30 +57,80 @@ static struct lock open_inodes_lock;
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache that in-memory inodes are allocated from. */
+static struct slab_cache* inode_cache;
+
+/* Number of freed sectors the reaper collects before updating
+   the free map. */
+#define REAP_BATCH 256
+
+/* A removed inode whose blocks are waiting to be freed. */
+struct reap_item {
+  block_sector_t sector; /* Sector of the removed inode. */
+  struct list_elem elem; /* Element in reap_queue. */
+};
+
+/* Removed inodes are handed to a background reaper thread, so
+   that closing a large deleted file doesn't stall the closer. */
+static struct list reap_queue;         /* Removed inodes waiting to be freed. */
+static struct lock reap_queue_lock;    /* Protects reap_queue. */
+static struct condition reap_queue_cv; /* Signaled when reap_queue gains an item. */
+static struct lock reap_lock;          /* Held while blocks are being freed. */
+
+static void reaper(void* aux UNUSED);
+static void inode_reap_all(void);
+static void inode_reap(block_sector_t sector);
+static void reap_add(block_sector_t* batch, size_t* cnt, block_sector_t sector);
+static bool inode_set_block(struct inode_disk* id, block_sector_t id_sector, size_t idx,
+                            block_sector_t sector);
+static bool chunk_packed(struct inode_disk* id, int idx);
+static bool inode_read_chunk(struct inode* inode, int idx, void* buffer, int ofs, int size);
+static void inode_pack(struct inode* inode);
+static void inode_dirty_chunks(struct inode* inode, off_t start, off_t end);
+static bool inode_unpack(struct inode* inode);
+static off_t read_at(struct inode* inode, void* buffer_, off_t size, off_t offset);
+static off_t write_at(struct inode* inode, const void* buffer_, off_t size, off_t offset);
+
 /* Initializes the inode module. */
 void inode_init(void) {
+  inode_cache = slab_cache_create("inode", sizeof(struct inode), NULL);
   lock_init(&open_inodes_lock);
   list_init(&open_inodes);
+
+  list_init(&reap_queue);
+  lock_init(&reap_queue_lock);
+  cond_init(&reap_queue_cv);
+  lock_init(&reap_lock);
+  thread_create("reaper", PRI_DEFAULT, reaper, NULL);
 }
 
-/* Resizes inode on disk ID located at sector ID_SECTOR to length SIZE. */
+/* Frees the blocks of any removed inodes still waiting for the
+   reaper.  Called at file system shutdown, before the free map
+   is closed. */
+void inode_done(void) { inode_reap_all(); }
+
+/* Resizes inode on disk ID located at sector ID_SECTOR to length SIZE.
+   Blocks freed by shrinking are released to the free map in
+   batches rather than one free map write per block. */
 bool inode_resize(struct inode_disk* id, block_sector_t id_sector, off_t size) {
   // Allocate buffers
   block_sector_t* buffer = (block_sector_t*)malloc(sizeof(block_sector_t) * NUM_INDIRECT);
   block_sector_t* buffer2 = (block_sector_t*)malloc(sizeof(block_sector_t) * NUM_INDIRECT);
   int* zero_block = (int*)calloc(1, BLOCK_SECTOR_SIZE);
+  block_sector_t* freed = (block_sector_t*)malloc(sizeof(block_sector_t) * REAP_BATCH);
+  size_t freed_cnt = 0;
 
   /* Direct pointers */
   for (int i = 0; i < TOTAL_DIRECT; i++) {
     if (size <= BLOCK_SECTOR_SIZE * i && id->direct[i] != 0) {
       // Free direct data blocks if needed
-      free_map_release(id->direct[i], 1);
+      reap_add(freed, &freed_cnt, id->direct[i]);
       id->direct[i] = 0;
     } else if (size > BLOCK_SECTOR_SIZE * i && id->direct[i] == 0) {
       // Allocate and zero out the new data block
       if (!free_map_allocate(1, &id->direct[i]))
         goto rollback;
-      cache_write(fs_device, id->direct[i], zero_block);
+      cache_write(fs_device, id->direct[i], zero_block, id_sector);
     }
   }
 
@@ -72,22 +153,22 @@ bool inode_resize(struct inode_disk* id, block_sector_t id_sector, off_t size) {
   for (int i = 0; i < NUM_INDIRECT; i++) {
     if (size <= (TOTAL_DIRECT + i) * BLOCK_SECTOR_SIZE && buffer[i] != 0) {
       // Free data blocks in indirect tree if needed
-      free_map_release(buffer[i], 1);
+      reap_add(freed, &freed_cnt, buffer[i]);
       buffer[i] = 0;
     } else if (size > (TOTAL_DIRECT + i) * BLOCK_SECTOR_SIZE && buffer[i] == 0) {
       // Allocate and zero out new data block
       if (!free_map_allocate(1, &buffer[i]))
         goto rollback;
-      cache_write(fs_device, buffer[i], zero_block);
+      cache_write(fs_device, buffer[i], zero_block, id_sector);
     }
   }
   if (id->indirect != 0 && size <= TOTAL_DIRECT * BLOCK_SECTOR_SIZE) {
     // Free indirect pointer if it is allocated and not needed
-    free_map_release(id->indirect, 1);
+    reap_add(freed, &freed_cnt, id->indirect);
     id->indirect = 0;
   } else if (id->indirect != 0 && size > TOTAL_DIRECT * BLOCK_SECTOR_SIZE) {
     // Write indirect pointer tree to disk
-    cache_write(fs_device, id->indirect, buffer);
+    cache_write(fs_device, id->indirect, buffer, id_sector);
   }
 
   // Return early if we don't need the doubly indirect pointer and the tree doesn't need to be freed
@@ -123,48 +204,53 @@ bool inode_resize(struct inode_disk* id, block_sector_t id_sector, off_t size) {
     for (int j = 0; j < NUM_INDIRECT; j++) {
       if (size <= (TOTAL_DIRECT + NUM_INDIRECT + i * NUM_INDIRECT + j) * BLOCK_SECTOR_SIZE &&
           buffer2[j] != 0) {
-        free_map_release(buffer2[j], 1);
+        reap_add(freed, &freed_cnt, buffer2[j]);
         buffer2[j] = 0;
       } else if (size > (TOTAL_DIRECT + NUM_INDIRECT + i * NUM_INDIRECT + j) * BLOCK_SECTOR_SIZE &&
                  buffer2[j] == 0) {
         if (!free_map_allocate(1, &buffer2[j])) {
           goto rollback;
         }
-        cache_write(fs_device, buffer2[j], zero_block);
+        cache_write(fs_device, buffer2[j], zero_block, id_sector);
       }
     }
 
-    // Free indirect pointer if it is allocated and not needed
-    if (buffer[i] != 0 && size <= TOTAL_DIRECT * BLOCK_SECTOR_SIZE) {
-      free_map_release(buffer[i], 1);
+    // Free indirect pointer if it is allocated and none of its blocks are needed
+    off_t indirect_start = (TOTAL_DIRECT + NUM_INDIRECT + i * NUM_INDIRECT) * BLOCK_SECTOR_SIZE;
+    if (buffer[i] != 0 && size <= indirect_start) {
+      reap_add(freed, &freed_cnt, buffer[i]);
       buffer[i] = 0;
-    } else if (buffer[i] != 0 && size > TOTAL_DIRECT * BLOCK_SECTOR_SIZE) {
+    } else if (buffer[i] != 0) {
       // Write indirect pointer tree to disk
-      cache_write(fs_device, buffer[i], buffer2);
+      cache_write(fs_device, buffer[i], buffer2, id_sector);
     }
     // cache_write(fs_device, id->doubly_indirect, buffer);
   }
 
   if (id->doubly_indirect != 0 && size <= (TOTAL_DIRECT + NUM_INDIRECT) * BLOCK_SECTOR_SIZE) {
     // Free doubly indirect pointer if it is allocated and not needed
-    free_map_release(id->doubly_indirect, 1);
+    reap_add(freed, &freed_cnt, id->doubly_indirect);
     id->doubly_indirect = 0;
   } else {
     // Write doubly indirect tree to disk
-    cache_write(fs_device, id->doubly_indirect, buffer);
+    cache_write(fs_device, id->doubly_indirect, buffer, id_sector);
   }
 
 complete:
   // TODO: release all locks
+  free_map_release_batch(freed, freed_cnt);
+  free(freed);
   free(buffer);
   free(buffer2);
   free(zero_block);
   id->length = size;
-  cache_write(fs_device, id_sector, id);
+  cache_write(fs_device, id_sector, id, id_sector);
   return true;
 
 rollback:
   // TODO: release all locks
+  free_map_release_batch(freed, freed_cnt);
+  free(freed);
   free(buffer);
   free(buffer2);
   free(zero_block);
@@ -224,15 +310,16 @@ struct inode* inode_open(block_sector_t sector) {
   for (e = list_begin(&open_inodes); e != list_end(&open_inodes); e = list_next(e)) {
     inode = list_entry(e, struct inode, elem);
     if (inode->sector == sector) {
-      lock_release(&open_inodes_lock);
+      // Reopen before releasing the list lock, so a racing inode_close() can't free it
       inode_reopen(inode);
+      lock_release(&open_inodes_lock);
       return inode;
     }
   }
   lock_release(&open_inodes_lock);
 
   /* Allocate memory for inode. */
-  inode = malloc(sizeof *inode);
+  inode = slab_alloc(inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -246,6 +333,12 @@ struct inode* inode_open(block_sector_t sector) {
   inode->deny_write_cnt = 0;
   inode->deny_wait_cnt = 0;
   inode->removed = false;
+  inode->chunk_buf = NULL;
+  inode->chunk_idx = -1;
+  inode->dirty_start = inode->dirty_end = 0;
+  inode->io_cnt = 0;
+  inode->relocating = false;
+  cond_init(&inode->io_cv);
   lock_init(&inode->inode_lock);
   lock_init(&inode->deny_write_lock);
   cond_init(&inode->deny_write_cv);
@@ -268,74 +361,158 @@ block_sector_t inode_get_inumber(const struct inode* inode) { return inode->sect
 
 /* Closes INODE and writes it to disk.
    If this was the last reference to INODE, frees its memory.
-   If INODE was also a removed inode, frees its blocks. */
+   If INODE was also a removed inode, hands its blocks to the
+   reaper thread to be freed in the background. */
 void inode_close(struct inode* inode) {
   /* Ignore null pointer. */
   if (inode == NULL)
     return;
 
-  struct inode_disk* id = (struct inode_disk*)malloc(sizeof(struct inode_disk));
-  cache_read(fs_device, inode->sector, (void*)id);
-
-  /* Release resources if this was the last opener. */
+  // Compress a compress mode file now that it has gone cold.  We still count as an
+  // opener while packing, so an inode_open() meanwhile just reopens the inode.
   lock_acquire(&inode->inode_lock);
-  if (--inode->open_cnt == 0) {
-    lock_release(&inode->inode_lock);
+  if (inode->open_cnt == 1 && !inode->removed)
+    inode_pack(inode);
+  lock_release(&inode->inode_lock);
 
-    /* Remove from inode list and release lock. */
-    lock_acquire(&open_inodes_lock);
+  /* Drop our reference and, if it was the last, remove the inode
+     from the list in the same critical section, so that no
+     inode_open() can find it once its count reaches zero. */
+  lock_acquire(&open_inodes_lock);
+  lock_acquire(&inode->inode_lock);
+  bool last = --inode->open_cnt == 0;
+  if (last)
     list_remove(&inode->elem);
-    lock_release(&open_inodes_lock);
+  lock_release(&inode->inode_lock);
+  lock_release(&open_inodes_lock);
 
+  /* Release resources if this was the last opener. */
+  if (last) {
     /* Deallocate blocks if removed. */
     lock_acquire(&inode->inode_lock);
     if (inode->removed) {
       lock_release(&inode->inode_lock);
-      // Free all direct pointers
-      for (int i = 0; i < TOTAL_DIRECT; i++) {
-        if (id->direct[i] != 0)
-          free_map_release(id->direct[i], 1);
+      struct reap_item* item = malloc(sizeof *item);
+      if (item != NULL) {
+        item->sector = inode->sector;
+        lock_acquire(&reap_queue_lock);
+        list_push_back(&reap_queue, &item->elem);
+        cond_signal(&reap_queue_cv, &reap_queue_lock);
+        lock_release(&reap_queue_lock);
+      } else {
+        // Out of memory, so free the blocks ourselves
+        lock_acquire(&reap_lock);
+        inode_reap(inode->sector);
+        lock_release(&reap_lock);
       }
+    } else {
+      lock_release(&inode->inode_lock);
+    }
+    free(inode->chunk_buf);
+    slab_free(inode_cache, inode);
+  }
+}
 
-      // Free the indirect pointer tree
-      if (id->indirect != 0) {
-        block_sector_t buffer[NUM_INDIRECT];
-        cache_read(fs_device, id->indirect, buffer);
-        for (int i = 0; i < NUM_INDIRECT; i++) {
-          if (buffer[i] != 0)
-            free_map_release(buffer[i], 1);
-        }
-        free_map_release(id->indirect, 1);
-      }
+/* Reaper thread.  Waits for removed inodes to be queued and
+   frees their blocks. */
+static void reaper(void* aux UNUSED) {
+  for (;;) {
+    lock_acquire(&reap_queue_lock);
+    while (list_empty(&reap_queue))
+      cond_wait(&reap_queue_cv, &reap_queue_lock);
+    lock_release(&reap_queue_lock);
 
-      // Free the doubly indirect tree
-      if (id->doubly_indirect != 0) {
-        block_sector_t buffer[NUM_INDIRECT];
-        block_sector_t buffer2[NUM_INDIRECT];
-        cache_read(fs_device, id->doubly_indirect, buffer);
-        for (int i = 0; i < NUM_INDIRECT; i++) {
-          if (buffer[i] == 0)
-            continue;
-          cache_read(fs_device, buffer[i], buffer2);
-          for (int j = 0; j < NUM_INDIRECT; j++) {
-            if (buffer2[j] != 0)
-              free_map_release(buffer2[j], 1);
-          }
-          free_map_release(buffer[i], 1);
-        }
-        free_map_release(id->doubly_indirect, 1);
-      }
+    inode_reap_all();
+  }
+}
 
-      // Free the inode_disk
-      free_map_release(inode->sector, 1);
-    } else {
-      lock_release(&inode->inode_lock);
+/* Frees the blocks of every inode on the reap queue. */
+static void inode_reap_all(void) {
+  lock_acquire(&reap_lock);
+  for (;;) {
+    lock_acquire(&reap_queue_lock);
+    if (list_empty(&reap_queue)) {
+      lock_release(&reap_queue_lock);
+      break;
     }
-    free(inode);
-  } else {
-    lock_release(&inode->inode_lock);
+    struct reap_item* item = list_entry(list_pop_front(&reap_queue), struct reap_item, elem);
+    lock_release(&reap_queue_lock);
+
+    inode_reap(item->sector);
+    free(item);
+  }
+  lock_release(&reap_lock);
+}
+
+/* Adds SECTOR to the CNT sectors in BATCH, releasing the whole
+   batch to the free map once it is full. */
+static void reap_add(block_sector_t* batch, size_t* cnt, block_sector_t sector) {
+  batch[(*cnt)++] = sector;
+  if (*cnt == REAP_BATCH) {
+    free_map_release_batch(batch, *cnt);
+    *cnt = 0;
+  }
+}
+
+/* Frees the data blocks, index blocks and on-disk inode of the
+   removed inode stored at SECTOR.  Sectors are released to the
+   free map in batches, so the free map is rewritten once per
+   REAP_BATCH sectors rather than once per sector.
+   Caller must hold reap_lock. */
+static void inode_reap(block_sector_t sector) {
+  struct inode_disk* id = malloc(sizeof *id);
+  block_sector_t* batch = malloc(sizeof *batch * REAP_BATCH);
+  block_sector_t* buffer = malloc(sizeof *buffer * NUM_INDIRECT);
+  block_sector_t* buffer2 = malloc(sizeof *buffer2 * NUM_INDIRECT);
+  size_t cnt = 0;
+
+  ASSERT(lock_held_by_current_thread(&reap_lock));
+  if (id == NULL || batch == NULL || buffer == NULL || buffer2 == NULL)
+    PANIC("couldn't allocate buffers to free removed inode");
+
+  cache_read(fs_device, sector, id);
+
+  // Free all direct pointers
+  for (int i = 0; i < TOTAL_DIRECT; i++) {
+    if (id->direct[i] != 0)
+      reap_add(batch, &cnt, id->direct[i]);
+  }
+
+  // Free the indirect pointer tree
+  if (id->indirect != 0) {
+    cache_read(fs_device, id->indirect, buffer);
+    for (int i = 0; i < NUM_INDIRECT; i++) {
+      if (buffer[i] != 0)
+        reap_add(batch, &cnt, buffer[i]);
+    }
+    reap_add(batch, &cnt, id->indirect);
   }
+
+  // Free the doubly indirect tree
+  if (id->doubly_indirect != 0) {
+    cache_read(fs_device, id->doubly_indirect, buffer);
+    for (int i = 0; i < NUM_INDIRECT; i++) {
+      if (buffer[i] == 0)
+        continue;
+      cache_read(fs_device, buffer[i], buffer2);
+      for (int j = 0; j < NUM_INDIRECT; j++) {
+        if (buffer2[j] != 0)
+          reap_add(batch, &cnt, buffer2[j]);
+      }
+      reap_add(batch, &cnt, buffer[i]);
+    }
+    reap_add(batch, &cnt, id->doubly_indirect);
+  }
+
+  // Free the inode_disk
+  reap_add(batch, &cnt, sector);
+  if (cnt > 0)
+    free_map_release_batch(batch, cnt);
+
   free(id);
+  free(batch);
+  free(buffer);
+  free(buffer2);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -390,15 +567,71 @@ block_sector_t inode_byte_to_sector(struct inode_disk* id, off_t pos) {
   }
 }
 
+/* Waits until no one is moving or freeing INODE's blocks, then
+   counts a read or write of INODE as in progress. */
+static void inode_io_begin(struct inode* inode) {
+  lock_acquire(&inode->inode_lock);
+  while (inode->relocating)
+    cond_wait(&inode->io_cv, &inode->inode_lock);
+  inode->io_cnt++;
+  lock_release(&inode->inode_lock);
+}
+
+/* Ends a read or write of INODE started by inode_io_begin(). */
+static void inode_io_end(struct inode* inode) {
+  lock_acquire(&inode->inode_lock);
+  if (--inode->io_cnt == 0)
+    cond_broadcast(&inode->io_cv, &inode->inode_lock);
+  lock_release(&inode->inode_lock);
+}
+
+/* Waits for the reads and writes of INODE in progress to finish
+   and holds off new ones until inode_io_allow(), so that the
+   caller can move or free INODE's blocks without any of them
+   using a stale block pointer.  Caller must hold INODE's
+   inode_lock. */
+static void inode_io_exclude(struct inode* inode) {
+  while (inode->relocating)
+    cond_wait(&inode->io_cv, &inode->inode_lock);
+  inode->relocating = true;
+  while (inode->io_cnt > 0)
+    cond_wait(&inode->io_cv, &inode->inode_lock);
+}
+
+/* Lets reads and writes of INODE held off by inode_io_exclude()
+   proceed.  Caller must hold INODE's inode_lock. */
+static void inode_io_allow(struct inode* inode) {
+  inode->relocating = false;
+  cond_broadcast(&inode->io_cv, &inode->inode_lock);
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
    than SIZE if an error occurs or end of file is reached. */
-off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset) {
+off_t inode_read_at(struct inode* inode, void* buffer, off_t size, off_t offset) {
+  inode_io_begin(inode);
+  off_t bytes_read = read_at(inode, buffer, size, offset);
+  inode_io_end(inode);
+  return bytes_read;
+}
+
+/* Returns true if a transfer of SIZE bytes to or from INODE,
+   whose on-disk inode is ID, should bypass the buffer cache.
+   Directories and the free map are metadata that is rewritten
+   often, such as the whole free map on every allocation, so they
+   always stay cached. */
+static bool use_direct_io(const struct inode* inode, const struct inode_disk* id, off_t size) {
+  return size >= DIRECT_IO_MIN && !id->isdir && inode->sector != FREE_MAP_SECTOR;
+}
+
+/* Does the work of inode_read_at(). */
+static off_t read_at(struct inode* inode, void* buffer_, off_t size, off_t offset) {
   uint8_t* buffer = buffer_;
   off_t bytes_read = 0;
 
   struct inode_disk* id = (struct inode_disk*)malloc(sizeof(struct inode_disk));
   cache_read(fs_device, inode->sector, (void*)id);
+  bool direct = use_direct_io(inode, id, size);
 
   /* Return 0 if offset is past EOF */
   if (offset + size > id->length) {
@@ -407,6 +640,24 @@ off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset
   }
 
   while (size > 0) {
+    /* Compressed chunks are read through the chunk buffer. */
+    int chunk_idx = offset / COMPRESS_CHUNK_SIZE;
+    if (chunk_packed(id, chunk_idx)) {
+      int buf_ofs = offset % COMPRESS_CHUNK_SIZE;
+      int buf_size = size < COMPRESS_CHUNK_SIZE - buf_ofs ? size : COMPRESS_CHUNK_SIZE - buf_ofs;
+      if (!inode_read_chunk(inode, chunk_idx, buffer + bytes_read, buf_ofs, buf_size)) {
+        // Retry as a plain read if a writer just expanded the chunk
+        cache_read(fs_device, inode->sector, (void*)id);
+        if (chunk_packed(id, chunk_idx))
+          break;
+        continue;
+      }
+      size -= buf_size;
+      offset += buf_size;
+      bytes_read += buf_size;
+      continue;
+    }
+
     /* Disk sector to read, starting byte offset within sector. */
     block_sector_t sector_idx = inode_byte_to_sector(id, offset);
     if (sector_idx == (block_sector_t)-1) {
@@ -427,7 +678,10 @@ off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset
 
     if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE) {
       /* Read full sector directly into caller's buffer. */
-      cache_read(fs_device, sector_idx, buffer + bytes_read);
+      if (direct)
+        cache_read_direct(fs_device, sector_idx, buffer + bytes_read);
+      else
+        cache_read(fs_device, sector_idx, buffer + bytes_read);
     } else {
       cache_read_at(fs_device, sector_idx, buffer + bytes_read, chunk_size, sector_ofs);
     }
@@ -446,9 +700,18 @@ off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset
    less than SIZE if end of file is reached or an error occurs.
    (Normally a write at end of file would extend the inode, but
    growth is not yet implemented.) */
-off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t offset) {
+off_t inode_write_at(struct inode* inode, const void* buffer, off_t size, off_t offset) {
+  inode_io_begin(inode);
+  off_t bytes_written = write_at(inode, buffer, size, offset);
+  inode_io_end(inode);
+  return bytes_written;
+}
+
+/* Does the work of inode_write_at(). */
+static off_t write_at(struct inode* inode, const void* buffer_, off_t size, off_t offset) {
   const uint8_t* buffer = buffer_;
   off_t bytes_written = 0;
+  off_t start = offset;
 
   if (inode->deny_write_cnt) {
     return 0;
@@ -456,11 +719,26 @@ off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t
 
   struct inode_disk* id = (struct inode_disk*)malloc(sizeof(struct inode_disk));
   cache_read(fs_device, inode->sector, (void*)id);
+  bool direct = use_direct_io(inode, id, size);
+
+  /* Expand compressed chunks before writing over them. */
+  if (id->packed) {
+    lock_acquire(&inode->inode_lock);
+    bool unpacked = inode_unpack(inode);
+    lock_release(&inode->inode_lock);
+    if (!unpacked) {
+      free(id);
+      return 0;
+    }
+    cache_read(fs_device, inode->sector, (void*)id);
+  }
 
   /* Extend the file if the offset is greater than the current inode_disk length */
   if (offset + size > id->length) {
     lock_acquire(&inode->inode_lock);
-    if (!inode_resize(id, inode->sector, offset + size)) {
+    // Reread under the lock, since an appender may have just extended the file
+    cache_read(fs_device, inode->sector, (void*)id);
+    if (offset + size > id->length && !inode_resize(id, inode->sector, offset + size)) {
       lock_release(&inode->inode_lock);
       free(id);
       return 0;
@@ -491,9 +769,13 @@ off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t
 
     if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE) {
       /* Write full sector directly to disk. */
-      cache_write(fs_device, sector_idx, buffer + bytes_written);
+      if (direct)
+        cache_write_direct(fs_device, sector_idx, buffer + bytes_written, inode->sector);
+      else
+        cache_write(fs_device, sector_idx, buffer + bytes_written, inode->sector);
     } else {
-      cache_write_at(fs_device, sector_idx, buffer + bytes_written, chunk_size, sector_ofs);
+      cache_write_at(fs_device, sector_idx, buffer + bytes_written, chunk_size, sector_ofs,
+                     inode->sector);
     }
 
     /* Advance. */
@@ -501,6 +783,12 @@ off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t
     offset += chunk_size;
     bytes_written += chunk_size;
   }
+
+  if (id->compress && bytes_written > 0) {
+    lock_acquire(&inode->inode_lock);
+    inode_dirty_chunks(inode, start, start + bytes_written);
+    lock_release(&inode->inode_lock);
+  }
   free(id);
 
   return bytes_written;
@@ -522,6 +810,465 @@ void inode_allow_write(struct inode* inode) {
   inode->deny_write_cnt--;
 }
 
+/* Writes SIZE bytes from BUFFER at the end of INODE and stores
+   the offset they went to into *OFFSET.  Only reserving the byte
+   range, by extending the length under the inode lock, is
+   serialized, so concurrent appenders copy their data in
+   parallel.  Until an appender finishes, its range reads as
+   zeros.  The append counts as I/O in progress from the moment
+   its range is reserved, so a truncate can't free the range
+   before the data lands.  Returns the number of bytes written,
+   which is 0 if the file couldn't be extended. */
+off_t inode_append(struct inode* inode, const void* buffer, off_t size, off_t* offset) {
+  if (inode->deny_write_cnt || size <= 0)
+    return 0;
+
+  lock_acquire(&inode->inode_lock);
+  while (inode->relocating)
+    cond_wait(&inode->io_cv, &inode->inode_lock);
+  if (!inode_unpack(inode)) {
+    lock_release(&inode->inode_lock);
+    return 0;
+  }
+  struct inode_disk* id = get_inode_disk(inode);
+  *offset = id->length;
+  bool reserved = inode_resize(id, inode->sector, id->length + size);
+  free(id);
+  if (reserved)
+    inode->io_cnt++;
+  lock_release(&inode->inode_lock);
+  if (!reserved)
+    return 0;
+
+  off_t bytes_written = write_at(inode, buffer, size, *offset);
+  inode_io_end(inode);
+  return bytes_written;
+}
+
+/* Points entry IDX of the index block at *INDEX to SECTOR,
+   allocating a zeroed index block into *INDEX first if it is 0.
+   Writes are tagged with the inode in sector OWNER.  Returns
+   false if a new index block can't be allocated. */
+static bool index_block_set(block_sector_t* index, size_t idx, block_sector_t sector,
+                            block_sector_t owner) {
+  block_sector_t buffer[NUM_INDIRECT];
+
+  if (*index == 0) {
+    if (!free_map_allocate(1, index))
+      return false;
+    memset(buffer, 0, sizeof buffer);
+  } else {
+    cache_read(fs_device, *index, buffer);
+  }
+  buffer[idx] = sector;
+  cache_write(fs_device, *index, buffer, owner);
+  return true;
+}
+
+/* Points data block IDX of the inode ID, stored at ID_SECTOR, at
+   SECTOR, allocating index blocks as needed.  Returns false if
+   an index block can't be allocated. */
+static bool inode_set_block(struct inode_disk* id, block_sector_t id_sector, size_t idx,
+                            block_sector_t sector) {
+  if (idx < TOTAL_DIRECT) {
+    id->direct[idx] = sector;
+    return true;
+  }
+  idx -= TOTAL_DIRECT;
+  if (idx < NUM_INDIRECT)
+    return index_block_set(&id->indirect, idx, sector, id_sector);
+
+  // Find, or make, the indirect block under the doubly indirect block
+  idx -= NUM_INDIRECT;
+  block_sector_t indirect = 0;
+  if (id->doubly_indirect != 0) {
+    block_sector_t buffer[NUM_INDIRECT];
+    cache_read(fs_device, id->doubly_indirect, buffer);
+    indirect = buffer[idx / NUM_INDIRECT];
+  }
+  if (indirect != 0)
+    return index_block_set(&indirect, idx % NUM_INDIRECT, sector, id_sector);
+  if (!index_block_set(&indirect, idx % NUM_INDIRECT, sector, id_sector))
+    return false;
+  if (!index_block_set(&id->doubly_indirect, idx / NUM_INDIRECT, indirect, id_sector)) {
+    free_map_release(indirect, 1);
+    return false;
+  }
+  return true;
+}
+
+/* Grows INODE to at least LENGTH bytes.  The new data blocks are
+   reserved as one contiguous extent when the free map has one,
+   and are zeroed with multi-sector writes that bypass the buffer
+   cache, instead of one cached write per block.  Falls back to
+   inode_resize()'s block-at-a-time allocation otherwise.
+   Returns true if successful, false if INODE is not writable or
+   the disk is full. */
+bool inode_allocate(struct inode* inode, off_t length) {
+  if (inode->deny_write_cnt || length < 0 || bytes_to_sectors(length) > MAX_FILE_SECTORS)
+    return false;
+
+  lock_acquire(&inode->inode_lock);
+  inode_io_exclude(inode);
+  if (!inode_unpack(inode)) {
+    inode_io_allow(inode);
+    lock_release(&inode->inode_lock);
+    return false;
+  }
+  struct inode_disk* id = get_inode_disk(inode);
+  bool success = true;
+  if (length > id->length) {
+    size_t old_cnt = bytes_to_sectors(id->length);
+    size_t new_cnt = bytes_to_sectors(length);
+    block_sector_t start;
+
+    if (new_cnt > old_cnt && free_map_allocate(new_cnt - old_cnt, &start)) {
+      cache_write_zeros(start, new_cnt - old_cnt);
+      for (size_t i = old_cnt; i < new_cnt; i++) {
+        if (!inode_set_block(id, inode->sector, i, start + (i - old_cnt))) {
+          // Give back the unlinked tail; inode_resize() frees the rest
+          free_map_release(start + (i - old_cnt), new_cnt - i);
+          inode_resize(id, inode->sector, id->length);
+          success = false;
+          break;
+        }
+      }
+    }
+    off_t old_length = id->length;
+    success = success && inode_resize(id, inode->sector, length);
+    if (success)
+      inode_dirty_chunks(inode, old_length, length);
+  }
+  free(id);
+  inode_io_allow(inode);
+  lock_release(&inode->inode_lock);
+  return success;
+}
+
+/* Sets INODE's length to LENGTH, freeing the blocks past the new
+   end of file, or growing the file with zeros if LENGTH is larger.
+   Returns true if successful, false if INODE is not writable or
+   the disk is full. */
+bool inode_truncate(struct inode* inode, off_t length) {
+  if (inode->deny_write_cnt || length < 0 || bytes_to_sectors(length) > MAX_FILE_SECTORS)
+    return false;
+
+  // Wait out reads and writes in progress, which may use the blocks we free
+  lock_acquire(&inode->inode_lock);
+  inode_io_exclude(inode);
+  if (!inode_unpack(inode)) {
+    inode_io_allow(inode);
+    lock_release(&inode->inode_lock);
+    return false;
+  }
+  struct inode_disk* id = get_inode_disk(inode);
+  int sector_ofs = length % BLOCK_SECTOR_SIZE;
+  if (length < id->length && sector_ofs != 0) {
+    // Zero the rest of the new last sector, so growing the file again reads back zeros
+    void* zeros = calloc(1, BLOCK_SECTOR_SIZE);
+    if (zeros == NULL) {
+      free(id);
+      inode_io_allow(inode);
+      lock_release(&inode->inode_lock);
+      return false;
+    }
+    cache_write_at(fs_device, inode_byte_to_sector(id, length), zeros,
+                   BLOCK_SECTOR_SIZE - sector_ofs, sector_ofs, inode->sector);
+    free(zeros);
+  }
+  off_t old_length = id->length;
+  bool success = inode_resize(id, inode->sector, length);
+  if (success && length > old_length)
+    inode_dirty_chunks(inode, old_length, length);
+  free(id);
+  inode_io_allow(inode);
+  lock_release(&inode->inode_lock);
+  return success;
+}
+
+/* Returns true if chunk IDX of inode ID is stored compressed. */
+static bool chunk_packed(struct inode_disk* id, int idx) {
+  off_t end = (off_t)(idx + 1) * COMPRESS_CHUNK_SIZE;
+  return id->packed && end <= id->length &&
+         inode_byte_to_sector(id, end - BLOCK_SECTOR_SIZE) == (block_sector_t)-1;
+}
+
+/* Reads compressed chunk IDX of inode ID and decompresses it into
+   BUFFER, which must hold COMPRESS_CHUNK_SIZE bytes.  Returns
+   false if the chunk is corrupt or memory is short. */
+static bool chunk_read(struct inode_disk* id, int idx, uint8_t* buffer) {
+  off_t start = (off_t)idx * COMPRESS_CHUNK_SIZE;
+  uint8_t* stream = malloc(COMPRESS_CHUNK_SIZE);
+  if (stream == NULL)
+    return false;
+
+  cache_read(fs_device, inode_byte_to_sector(id, start), stream);
+  uint32_t size = *(uint32_t*)stream;
+  bool success = size <= CHUNK_STREAM_MAX;
+  if (success) {
+    size_t sectors = DIV_ROUND_UP(CHUNK_HEADER_SIZE + size, BLOCK_SECTOR_SIZE);
+    for (size_t i = 1; i < sectors; i++)
+      cache_read(fs_device, inode_byte_to_sector(id, start + i * BLOCK_SECTOR_SIZE),
+                 stream + i * BLOCK_SECTOR_SIZE);
+    success = decompress_chunk(stream + CHUNK_HEADER_SIZE, size, buffer, COMPRESS_CHUNK_SIZE);
+  }
+  free(stream);
+  return success;
+}
+
+/* Copies SIZE bytes at offset OFS within compressed chunk IDX of
+   INODE into BUFFER, decompressing the chunk into INODE's chunk
+   buffer unless it is there already.  Returns false if the chunk
+   is no longer compressed or can't be read. */
+static bool inode_read_chunk(struct inode* inode, int idx, void* buffer, int ofs, int size) {
+  bool success = true;
+
+  lock_acquire(&inode->inode_lock);
+  if (inode->chunk_idx != idx) {
+    struct inode_disk* id = get_inode_disk(inode);
+    if (inode->chunk_buf == NULL)
+      inode->chunk_buf = malloc(COMPRESS_CHUNK_SIZE);
+    success = inode->chunk_buf != NULL && chunk_packed(id, idx) &&
+              chunk_read(id, idx, inode->chunk_buf);
+    inode->chunk_idx = success ? idx : -1;
+    free(id);
+  }
+  if (success)
+    memcpy(buffer, inode->chunk_buf + ofs, size);
+  lock_release(&inode->inode_lock);
+  return success;
+}
+
+/* Marks the chunks of INODE that overlap bytes START through END
+   as changed since the last pack.  Caller must hold INODE's
+   inode_lock. */
+static void inode_dirty_chunks(struct inode* inode, off_t start, off_t end) {
+  int first = start / COMPRESS_CHUNK_SIZE;
+  int last = DIV_ROUND_UP(end, COMPRESS_CHUNK_SIZE);
+  if (first >= last)
+    return;
+  if (inode->dirty_start >= inode->dirty_end) {
+    inode->dirty_start = first;
+    inode->dirty_end = last;
+  } else {
+    inode->dirty_start = first < inode->dirty_start ? first : inode->dirty_start;
+    inode->dirty_end = last > inode->dirty_end ? last : inode->dirty_end;
+  }
+}
+
+/* Compresses each full chunk of INODE, if it is in compress mode,
+   that was changed since the last pack and fits in fewer sectors,
+   and frees the sectors it no longer needs.  Chunks that don't
+   compress are left as they are and not tried again until they
+   are written.  Caller must hold INODE's inode_lock. */
+static void inode_pack(struct inode* inode) {
+  if (inode->dirty_start >= inode->dirty_end)
+    return;
+
+  struct inode_disk* id = get_inode_disk(inode);
+  uint8_t* raw = malloc(COMPRESS_CHUNK_SIZE);
+  uint8_t* stream = malloc(COMPRESS_CHUNK_SIZE);
+  if (id->isdir || !id->compress || raw == NULL || stream == NULL)
+    goto done;
+
+  int cnt = id->length / COMPRESS_CHUNK_SIZE;
+  if (cnt > inode->dirty_end)
+    cnt = inode->dirty_end;
+  for (int c = inode->dirty_start; c < cnt; c++) {
+    block_sector_t sectors[COMPRESS_CHUNK_SECTORS];
+    if (chunk_packed(id, c))
+      continue;
+    for (int i = 0; i < COMPRESS_CHUNK_SECTORS; i++) {
+      sectors[i] = inode_byte_to_sector(id, (off_t)c * COMPRESS_CHUNK_SIZE + i * BLOCK_SECTOR_SIZE);
+      cache_read(fs_device, sectors[i], raw + i * BLOCK_SECTOR_SIZE);
+    }
+
+    uint32_t size =
+        compress_chunk(raw, COMPRESS_CHUNK_SIZE, stream + CHUNK_HEADER_SIZE, CHUNK_STREAM_MAX);
+    if (size == 0)
+      continue;
+    *(uint32_t*)stream = size;
+    size_t used = DIV_ROUND_UP(CHUNK_HEADER_SIZE + size, BLOCK_SECTOR_SIZE);
+    memset(stream + CHUNK_HEADER_SIZE + size, 0,
+           used * BLOCK_SECTOR_SIZE - CHUNK_HEADER_SIZE - size);
+
+    // Store the stream, then unlink and free the sectors it doesn't need
+    for (size_t i = 0; i < used; i++)
+      cache_write(fs_device, sectors[i], stream + i * BLOCK_SECTOR_SIZE, inode->sector);
+    for (size_t i = used; i < COMPRESS_CHUNK_SECTORS; i++)
+      inode_set_block(id, inode->sector, c * COMPRESS_CHUNK_SECTORS + i, 0);
+    free_map_release_batch(sectors + used, COMPRESS_CHUNK_SECTORS - used);
+    id->packed = 1;
+  }
+  cache_write(fs_device, inode->sector, id, inode->sector);
+  inode->chunk_idx = -1;
+  inode->dirty_start = inode->dirty_end = 0;
+
+done:
+  free(stream);
+  free(raw);
+  free(id);
+}
+
+/* Expands every compressed chunk of INODE back into
+   COMPRESS_CHUNK_SECTORS sectors, so that its blocks can be
+   written in place.  Caller must hold INODE's inode_lock.
+   Returns false if the disk is full or memory is short, in which
+   case the chunks not yet expanded stay compressed. */
+static bool inode_unpack(struct inode* inode) {
+  struct inode_disk* id = get_inode_disk(inode);
+  if (!id->packed) {
+    free(id);
+    return true;
+  }
+
+  uint8_t* raw = malloc(COMPRESS_CHUNK_SIZE);
+  bool success = raw != NULL;
+  int cnt = id->length / COMPRESS_CHUNK_SIZE;
+  for (int c = 0; success && c < cnt; c++) {
+    block_sector_t sectors[COMPRESS_CHUNK_SECTORS];
+    if (!chunk_packed(id, c))
+      continue;
+    if (!chunk_read(id, c, raw)) {
+      success = false;
+      break;
+    }
+
+    // Link a block into each hole; the chunk reads as compressed until the last one is in
+    for (int i = 0; i < COMPRESS_CHUNK_SECTORS; i++) {
+      sectors[i] = inode_byte_to_sector(id, (off_t)c * COMPRESS_CHUNK_SIZE + i * BLOCK_SECTOR_SIZE);
+      if (sectors[i] != (block_sector_t)-1)
+        continue;
+      if (!free_map_allocate(1, &sectors[i])) {
+        success = false;
+        break;
+      }
+      if (!inode_set_block(id, inode->sector, c * COMPRESS_CHUNK_SECTORS + i, sectors[i])) {
+        free_map_release(sectors[i], 1);
+        success = false;
+        break;
+      }
+    }
+    if (!success)
+      break;
+    for (int i = 0; i < COMPRESS_CHUNK_SECTORS; i++)
+      cache_write(fs_device, sectors[i], raw + i * BLOCK_SECTOR_SIZE, inode->sector);
+    // Repack the chunk at the next last close
+    off_t start = (off_t)c * COMPRESS_CHUNK_SIZE;
+    inode_dirty_chunks(inode, start, start + COMPRESS_CHUNK_SIZE);
+  }
+  if (success)
+    id->packed = 0;
+  cache_write(fs_device, inode->sector, id, inode->sector);
+  inode->chunk_idx = -1;
+
+  free(raw);
+  free(id);
+  return success;
+}
+
+/* Turns compress mode of INODE on or off.  Chunks are compressed
+   when the last opener closes INODE, and chunks written since are
+   compressed at each later last close; turning compress mode off
+   expands the chunks compressed so far.  Returns false if INODE
+   is a directory or its chunks can't be expanded. */
+bool inode_set_compress(struct inode* inode, bool compress) {
+  lock_acquire(&inode->inode_lock);
+  struct inode_disk* id = get_inode_disk(inode);
+  bool success = !id->isdir;
+  if (success) {
+    id->compress = compress;
+    cache_write(fs_device, inode->sector, id, inode->sector);
+    if (compress)
+      inode_dirty_chunks(inode, 0, id->length);
+  }
+  free(id);
+  if (success && !compress)
+    success = inode_unpack(inode);
+  lock_release(&inode->inode_lock);
+  return success;
+}
+
+/* Returns the number of extents, or runs of physically
+   contiguous data blocks, that the first CNT blocks of inode ID
+   are stored in.  Holes end an extent without starting one. */
+static int inode_extents(struct inode_disk* id, size_t cnt) {
+  block_sector_t prev = (block_sector_t)-1;
+  int extents = 0;
+
+  for (size_t i = 0; i < cnt; i++) {
+    block_sector_t sector = inode_byte_to_sector(id, (off_t)i * BLOCK_SECTOR_SIZE);
+    if (sector != (block_sector_t)-1 && (prev == (block_sector_t)-1 || sector != prev + 1))
+      extents++;
+    prev = sector;
+  }
+  return extents;
+}
+
+/* Moves the data blocks of INODE into one contiguous run of free
+   sectors, while the file stays open.  Reads and writes of INODE
+   wait until the blocks are moved, and those in progress are
+   waited for first, so none uses a stale block pointer.  Index
+   blocks stay where they are.  Stores the number of extents the
+   data was in before and after into *BEFORE and *AFTER.  Returns
+   false if INODE is a directory or no free run is long enough. */
+bool inode_defrag(struct inode* inode, int* before, int* after) {
+  bool success = false;
+  struct inode_disk* id = NULL;
+  block_sector_t* freed = malloc(sizeof(block_sector_t) * REAP_BATCH);
+  void* buffer = malloc(BLOCK_SECTOR_SIZE);
+  size_t freed_cnt = 0;
+
+  lock_acquire(&inode->inode_lock);
+  inode_io_exclude(inode);
+
+  if (freed == NULL || buffer == NULL || !inode_unpack(inode))
+    goto done;
+  id = get_inode_disk(inode);
+  if (id->isdir)
+    goto done;
+
+  size_t cnt = bytes_to_sectors(id->length);
+  *before = *after = inode_extents(id, cnt);
+  block_sector_t start;
+  if (*before <= 1) {
+    success = true;
+    goto done;
+  }
+  if (!free_map_allocate(cnt, &start))
+    goto done;
+
+  for (size_t i = 0; i < cnt; i++) {
+    block_sector_t old = inode_byte_to_sector(id, (off_t)i * BLOCK_SECTOR_SIZE);
+    cache_read_direct(fs_device, old, buffer);
+    cache_write_direct(fs_device, start + i, buffer, inode->sector);
+    // Index blocks exist already, so this can't fail
+    inode_set_block(id, inode->sector, i, start + i);
+    reap_add(freed, &freed_cnt, old);
+  }
+  cache_write(fs_device, inode->sector, id, inode->sector);
+  *after = 1;
+  success = true;
+
+done:
+  inode_io_allow(inode);
+  lock_release(&inode->inode_lock);
+  if (freed != NULL)
+    free_map_release_batch(freed, freed_cnt);
+  free(freed);
+  free(buffer);
+  free(id);
+  return success;
+}
+
+/* Writes the dirty cached sectors of the inode in SECTOR to disk,
+   along with the free map's, which records the blocks the inode
+   was given.  Other files' dirty sectors stay in the cache. */
+void inode_flush(block_sector_t sector) {
+  cache_flush_inode(sector);
+  cache_flush_inode(FREE_MAP_SECTOR);
+}
+
 /* Returns the length, in bytes, of INODE_DISK's data. */
 off_t inode_disk_length(const struct inode* inode) {
   struct inode_disk id;
@@ -537,6 +1284,15 @@ bool inode_isdir(struct inode* inode) {
   return res;
 }
 
+/* Stores the length and type of the inode at SECTOR into *LENGTH
+   and *ISDIR without opening it. */
+void inode_stat(block_sector_t sector, off_t* length, bool* isdir) {
+  struct inode_disk id;
+  cache_read(fs_device, sector, (void*)&id);
+  *length = id.length;
+  *isdir = id.isdir;
+}
+
 // Free everytime you call this function
 struct inode_disk* get_inode_disk(struct inode* inode) {
   struct inode_disk* id = malloc(sizeof(struct inode_disk));
@@ -20,7 +20,9 @@ struct inode_disk {
   block_sector_t direct[TOTAL_DIRECT]; /* ADDED: direct pointers (12 * 4 = 36 bytes) */
   block_sector_t indirect;             /* ADDED: indirect pointer (4 bytes) */
   block_sector_t doubly_indirect;      /* ADDED: doubly indirect pointer (4 bytes) */
-  uint32_t unused[110];                /* Not used. */
+  int compress;                        /* 1 if full chunks are compressed at last close (4 bytes) */
+  int packed;                          /* 1 if some chunks are stored compressed (4 bytes) */
+  uint32_t unused[108];                /* Not used. */
 };
 
 /* In-memory inode. */
@@ -35,6 +37,15 @@ struct inode {
   struct condition deny_write_cv; /* ADDED: Conditional variable for deny writes. */
   int deny_write_cnt; /* 0: writes ok, >0: deny writes. | CHANGED: Number of current writers. */
   int deny_wait_cnt;  /* ADDED: Number of waiting writers. */
+
+  uint8_t* chunk_buf; /* Last compressed chunk read, decompressed, or NULL. */
+  int chunk_idx;      /* Index of the chunk in chunk_buf, or -1 if none. */
+  int dirty_start;    /* First chunk written since the last pack. */
+  int dirty_end;      /* One past the last such chunk; no chunks if <= dirty_start. */
+
+  int io_cnt;             /* Number of reads and writes in progress. */
+  bool relocating;        /* True while blocks are being moved or freed. */
+  struct condition io_cv; /* Signaled when io_cnt drops to 0 or relocating ends. */
 };
 
 struct bitmap;
@@ -42,6 +53,7 @@ struct inode_disk;
 
 bool inode_resize(struct inode_disk* id, block_sector_t id_sector, off_t size);
 void inode_init(void);
+void inode_done(void);
 bool inode_create(block_sector_t, off_t, int);
 struct inode* inode_open(block_sector_t);
 struct inode* inode_reopen(struct inode*);
@@ -51,10 +63,17 @@ void inode_remove(struct inode*);
 block_sector_t inode_byte_to_sector(struct inode_disk* id, off_t pos);
 off_t inode_read_at(struct inode*, void*, off_t size, off_t offset);
 off_t inode_write_at(struct inode*, const void*, off_t size, off_t offset);
+off_t inode_append(struct inode*, const void*, off_t size, off_t* offset);
 void inode_deny_write(struct inode*);
 void inode_allow_write(struct inode*);
 // off_t inode_length(const struct inode*);
 bool inode_isdir(struct inode* inode);
+void inode_stat(block_sector_t sector, off_t* length, bool* isdir);
+void inode_flush(block_sector_t sector);
+bool inode_allocate(struct inode* inode, off_t length);
+bool inode_truncate(struct inode* inode, off_t length);
+bool inode_set_compress(struct inode* inode, bool compress);
+bool inode_defrag(struct inode* inode, int* before, int* after);
 struct inode_disk* get_inode_disk(struct inode* inode);
 off_t inode_disk_length(const struct inode* inode);
 
@@ -0,0 +1,19 @@
+#ifndef __LIB_DIRENT_H
+#define __LIB_DIRENT_H
+
+#include <stdbool.h>
+
+/* Maximum characters in a file name stored in a struct dirent. */
+#define DIRENT_NAME_MAX 14
+
+/* A directory entry together with its inode metadata, as filled
+   in by the getdents() system call.  Shared between the kernel
+   and user programs, so its layout must not depend on either. */
+struct dirent {
+  int inumber;                     /* Inode number (sector) of the entry. */
+  int length;                      /* Length of the file in bytes. */
+  bool isdir;                      /* True if the entry is a directory. */
+  char name[DIRENT_NAME_MAX + 1]; /* Null terminated file name. */
+};
+
+#endif /* lib/dirent.h */
@@ -43,6 +43,38 @@ static inline size_t elem_cnt(size_t bit_cnt) { return DIV_ROUND_UP(bit_cnt, ELE
 /* Returns the number of bytes required for BIT_CNT bits. */
 static inline size_t byte_cnt(size_t bit_cnt) { return sizeof(elem_type) * elem_cnt(bit_cnt); }
 
+/* Returns a bit mask of the bits of element ELEM that lie in
+   the bit range START...END, exclusive.  The range must overlap
+   the element. */
+static inline elem_type range_mask(size_t elem, size_t start, size_t end) {
+  size_t first = elem * ELEM_BITS;
+  elem_type mask = (elem_type)-1;
+
+  if (start > first)
+    mask &= (elem_type)-1 << (start - first);
+  if (end < first + ELEM_BITS)
+    mask &= ((elem_type)1 << (end - first)) - 1;
+  return mask;
+}
+
+/* Returns element ELEM of B, inverted if VALUE is false, so that
+   the bits set to VALUE in B are 1s. */
+static inline elem_type elem_value(const struct bitmap* b, size_t elem, bool value) {
+  return value ? b->bits[elem] : ~b->bits[elem];
+}
+
+/* Returns the index of the lowest 1 bit in nonzero X. */
+static inline size_t lowest_bit(elem_type x) { return __builtin_ctzl(x); }
+
+/* Returns the number of 1 bits in X.  __builtin_popcountl() would
+   compile to a call into libgcc, which the kernel doesn't link. */
+static inline size_t popcount(elem_type x) {
+  x = x - ((x >> 1) & 0x55555555);
+  x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+  x = (x + (x >> 4)) & 0x0f0f0f0f;
+  return (x * 0x01010101) >> 24;
+}
+
 /* Returns a bit mask in which the bits actually used in the last
    element of B's bits are set to 1 and the rest are set to 0. */
 static inline elem_type last_mask(const struct bitmap* b) {
@@ -165,7 +197,8 @@ void bitmap_set_all(struct bitmap* b, bool value) {
   bitmap_set_multiple(b, 0, bitmap_size(b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Each element is updated atomically, a whole element at a time. */
 void bitmap_set_multiple(struct bitmap* b, size_t start, size_t cnt, bool value) {
   size_t i;
 
@@ -173,8 +206,15 @@ void bitmap_set_multiple(struct bitmap* b, size_t start, size_t cnt, bool value)
   ASSERT(start <= b->bit_cnt);
   ASSERT(start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set(b, start + i, value);
+  if (cnt == 0)
+    return;
+  for (i = elem_idx(start); i <= elem_idx(start + cnt - 1); i++) {
+    elem_type mask = range_mask(i, start, start + cnt);
+    if (value)
+      asm("orl %1, %0" : "=m"(b->bits[i]) : "r"(mask) : "cc");
+    else
+      asm("andl %1, %0" : "=m"(b->bits[i]) : "r"(~mask) : "cc");
+  }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -187,9 +227,10 @@ size_t bitmap_count(const struct bitmap* b, size_t start, size_t cnt, bool value
   ASSERT(start + cnt <= b->bit_cnt);
 
   value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test(b, start + i) == value)
-      value_cnt++;
+  if (cnt == 0)
+    return 0;
+  for (i = elem_idx(start); i <= elem_idx(start + cnt - 1); i++)
+    value_cnt += popcount(elem_value(b, i, value) & range_mask(i, start, start + cnt));
   return value_cnt;
 }
 
@@ -202,8 +243,10 @@ bool bitmap_contains(const struct bitmap* b, size_t start, size_t cnt, bool valu
   ASSERT(start <= b->bit_cnt);
   ASSERT(start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test(b, start + i) == value)
+  if (cnt == 0)
+    return false;
+  for (i = elem_idx(start); i <= elem_idx(start + cnt - 1); i++)
+    if (elem_value(b, i, value) & range_mask(i, start, start + cnt))
       return true;
   return false;
 }
@@ -233,15 +276,50 @@ bool bitmap_all(const struct bitmap* b, size_t start, size_t cnt) {
    VALUE.
    If there is no such group, returns BITMAP_ERROR. */
 size_t bitmap_scan(const struct bitmap* b, size_t start, size_t cnt, bool value) {
+  size_t run = 0, run_start = start;
+  size_t i;
+
   ASSERT(b != NULL);
   ASSERT(start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) {
-    size_t last = b->bit_cnt - cnt;
-    size_t i;
-    for (i = start; i <= last; i++)
-      if (!bitmap_contains(b, i, cnt, !value))
-        return i;
+  if (cnt > b->bit_cnt || start > b->bit_cnt - cnt)
+    return BITMAP_ERROR;
+  if (cnt == 0)
+    return start;
+
+  /* Walk the runs of VALUE bits a word at a time, jumping over
+     whole words that hold none, until one is CNT bits long. */
+  for (i = elem_idx(start); i < elem_cnt(b->bit_cnt); i++) {
+    size_t first = i * ELEM_BITS;
+    elem_type bits = elem_value(b, i, value) & range_mask(i, start, b->bit_cnt);
+    size_t ofs = 0;
+
+    if (bits == 0) {
+      run = 0;
+      continue;
+    }
+    while (ofs < ELEM_BITS) {
+      elem_type rest = bits >> ofs;
+      if (rest == 0) {
+        run = 0;
+        break;
+      }
+      if ((rest & 1) == 0) {
+        // Skip to the next VALUE bit, which starts a new run
+        ofs += lowest_bit(rest);
+        run = 0;
+        continue;
+      }
+
+      // Extend the run through the VALUE bits starting at OFS
+      size_t len = ~rest == 0 ? ELEM_BITS - ofs : lowest_bit(~rest);
+      if (run == 0)
+        run_start = first + ofs;
+      run += len;
+      if (run >= cnt)
+        return run_start;
+      ofs += len;
+    }
   }
   return BITMAP_ERROR;
 }
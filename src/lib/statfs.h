@@ -0,0 +1,13 @@
+#ifndef __LIB_STATFS_H
+#define __LIB_STATFS_H
+
+/* File system space usage, as filled in by the statfs() system
+   call.  Shared between the kernel and user programs, so its
+   layout must not depend on either. */
+struct statfs {
+  int sector_size;   /* Bytes per sector. */
+  int total_sectors; /* Sectors in the file system, including metadata. */
+  int free_sectors;  /* Sectors not in use. */
+};
+
+#endif /* lib/statfs.h */
@@ -35,11 +35,20 @@ enum {
   SYS_MUNMAP, /* Remove a memory mapping. */
 
   /* Project 4 only. */
-  SYS_CHDIR,   /* Change the current directory. */
-  SYS_MKDIR,   /* Create a directory. */
-  SYS_READDIR, /* Reads a directory entry. */
-  SYS_ISDIR,   /* Tests if a fd represents a directory. */
-  SYS_INUMBER  /* Returns the inode number for a fd. */
+  SYS_CHDIR,       /* Change the current directory. */
+  SYS_MKDIR,       /* Create a directory. */
+  SYS_READDIR,     /* Reads a directory entry. */
+  SYS_ISDIR,       /* Tests if a fd represents a directory. */
+  SYS_INUMBER,     /* Returns the inode number for a fd. */
+  SYS_GETDENTS,    /* Reads many directory entries with metadata. */
+  SYS_FSYNC,       /* Writes a file's cached data to disk. */
+  SYS_SYNC,        /* Writes all cached data to disk. */
+  SYS_FALLOCATE,   /* Reserves space for a file. */
+  SYS_TRUNCATE,    /* Changes the length of a file. */
+  SYS_OPEN_APPEND, /* Opens a file in append mode. */
+  SYS_COMPRESS,    /* Turns a file's compress mode on or off. */
+  SYS_DEFRAG,      /* Moves a file's blocks into one contiguous run. */
+  SYS_STATFS       /* Reports file system space usage. */
 };
 
 #endif /* lib/syscall-nr.h */
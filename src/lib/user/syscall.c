@@ -116,6 +116,26 @@ bool isdir(int fd) { return syscall1(SYS_ISDIR, fd); }
 
 int inumber(int fd) { return syscall1(SYS_INUMBER, fd); }
 
+int getdents(int fd, struct dirent* entries, unsigned cnt) {
+  return syscall3(SYS_GETDENTS, fd, entries, cnt);
+}
+
+bool fsync(int fd) { return syscall1(SYS_FSYNC, fd); }
+
+void sync(void) { syscall0(SYS_SYNC); }
+
+bool fallocate(int fd, unsigned length) { return syscall2(SYS_FALLOCATE, fd, length); }
+
+bool truncate(int fd, unsigned length) { return syscall2(SYS_TRUNCATE, fd, length); }
+
+int open_append(const char* file) { return syscall1(SYS_OPEN_APPEND, file); }
+
+bool compress(int fd, bool enable) { return syscall2(SYS_COMPRESS, fd, (int)enable); }
+
+bool defrag(int fd, int* before, int* after) { return syscall3(SYS_DEFRAG, fd, before, after); }
+
+void statfs(struct statfs* st) { syscall1(SYS_STATFS, st); }
+
 double compute_e(int n) { return (double)syscall1f(SYS_COMPUTE_E, n); }
 
 tid_t sys_pthread_create(stub_fun sfun, pthread_fun tfun, const void* arg) {
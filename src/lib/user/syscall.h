@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <pthread.h>
+#include <dirent.h>
+#include <statfs.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -61,5 +63,14 @@ bool mkdir(const char* dir);
 bool readdir(int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir(int fd);
 int inumber(int fd);
+int getdents(int fd, struct dirent* entries, unsigned cnt);
+bool fsync(int fd);
+void sync(void);
+bool fallocate(int fd, unsigned length);
+bool truncate(int fd, unsigned length);
+int open_append(const char* file);
+bool compress(int fd, bool enable);
+bool defrag(int fd, int* before, int* after);
+void statfs(struct statfs* st);
 
 #endif /* lib/user/syscall.h */
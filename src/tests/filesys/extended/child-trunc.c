@@ -0,0 +1,32 @@
+/* Child process for syn-truncate.
+   Opens the log file in append mode and appends RECORD_CNT
+   records, each filled with a byte that identifies this child,
+   while the parent truncates the file. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/filesys/extended/syn-truncate.h"
+#include "tests/lib.h"
+
+static char record[RECORD_SIZE];
+
+int main(int argc, const char* argv[]) {
+  int child_idx;
+  int fd, i;
+
+  test_name = "child-trunc";
+  quiet = true;
+
+  CHECK(argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi(argv[1]);
+  memset(record, 'a' + child_idx, sizeof record);
+
+  CHECK((fd = open_append(file_name)) > 1, "open_append \"%s\"", file_name);
+  for (i = 0; i < RECORD_CNT; i++)
+    CHECK(write(fd, record, sizeof record) == (int)sizeof record,
+          "append record %d to \"%s\"", i, file_name);
+  close(fd);
+
+  return child_idx;
+}
@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_archive ({'a' => {'f0' => [''],
+			'f1' => ["\0" x 100],
+			'f2' => ["\0" x 1234],
+			'sub' => {}}});
+pass;
@@ -0,0 +1,48 @@
+/* Fills a directory with files of different sizes and a
+   subdirectory, then reads it back with getdents() a few
+   entries at a time and checks each entry's metadata. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void test_main(void) {
+  static const char* names[] = {"f0", "f1", "f2", "sub"};
+  static const int lengths[] = {0, 100, 1234, 0};
+  struct dirent entries[3];
+  int fd, cnt, i, total;
+  int sub_inumber;
+
+  CHECK(mkdir("a"), "mkdir \"a\"");
+  CHECK(create("a/f0", 0), "create \"a/f0\"");
+  CHECK(create("a/f1", 100), "create \"a/f1\"");
+  CHECK(create("a/f2", 1234), "create \"a/f2\"");
+  CHECK(mkdir("a/sub"), "mkdir \"a/sub\"");
+  CHECK((fd = open("a/sub")) > 1, "open \"a/sub\"");
+  sub_inumber = inumber(fd);
+  close(fd);
+
+  CHECK((fd = open("a")) > 1, "open \"a\"");
+  total = 0;
+  while ((cnt = getdents(fd, entries, 3)) > 0) {
+    for (i = 0; i < cnt; i++, total++) {
+      struct dirent* e = &entries[i];
+      bool want_dir = total == 3;
+
+      if (total >= 4)
+        fail("getdents returned too many entries");
+      if (strcmp(e->name, names[total]))
+        fail("entry %d is \"%s\", expected \"%s\"", total, e->name, names[total]);
+      if (e->isdir != want_dir)
+        fail("\"%s\" has the wrong type", e->name);
+      if (!want_dir && e->length != lengths[total])
+        fail("\"%s\" is %d bytes, expected %d", e->name, e->length, lengths[total]);
+      if (want_dir && e->inumber != sub_inumber)
+        fail("\"%s\" has inumber %d, expected %d", e->name, e->inumber, sub_inumber);
+      msg("entry \"%s\"", e->name);
+    }
+  }
+  CHECK(total == 4, "getdents returned all entries");
+  close(fd);
+}
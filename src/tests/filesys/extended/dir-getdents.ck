@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-getdents) begin
+(dir-getdents) mkdir "a"
+(dir-getdents) create "a/f0"
+(dir-getdents) create "a/f1"
+(dir-getdents) create "a/f2"
+(dir-getdents) mkdir "a/sub"
+(dir-getdents) open "a/sub"
+(dir-getdents) open "a"
+(dir-getdents) entry "f0"
+(dir-getdents) entry "f1"
+(dir-getdents) entry "f2"
+(dir-getdents) entry "sub"
+(dir-getdents) getdents returned all entries
+(dir-getdents) end
+EOF
+pass;
@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($data) = "abcdefghij" x 2000;
+substr ($data, 10000, 8) = "modified";
+check_archive ({"testme" => [$data]});
+pass;
@@ -0,0 +1,36 @@
+/* Writes a compressible file in compress mode, checks that it
+   reads back after being compressed at close, then overwrites
+   part of it and checks it again. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[20000];
+
+void test_main(void) {
+  const char* file_name = "testme";
+  size_t i;
+  int fd;
+
+  for (i = 0; i < sizeof buf; i++)
+    buf[i] = "abcdefghij"[i % 10];
+  CHECK(create(file_name, 0), "create \"%s\"", file_name);
+  CHECK((fd = open(file_name)) > 1, "open \"%s\"", file_name);
+  CHECK(compress(fd, true), "compress \"%s\"", file_name);
+  CHECK(write(fd, buf, sizeof buf) == (int)sizeof buf, "write \"%s\"", file_name);
+  msg("close \"%s\"", file_name);
+  close(fd);
+  check_file(file_name, buf, sizeof buf);
+
+  CHECK((fd = open(file_name)) > 1, "open \"%s\"", file_name);
+  seek(fd, 10000);
+  CHECK(write(fd, "modified", 8) == 8, "overwrite \"%s\"", file_name);
+  memcpy(buf + 10000, "modified", 8);
+  msg("close \"%s\"", file_name);
+  close(fd);
+  check_file(file_name, buf, sizeof buf);
+
+  CHECK(!compress(-1, true), "compress bad fd");
+}
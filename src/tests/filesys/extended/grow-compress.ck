@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-compress) begin
+(grow-compress) create "testme"
+(grow-compress) open "testme"
+(grow-compress) compress "testme"
+(grow-compress) write "testme"
+(grow-compress) close "testme"
+(grow-compress) open "testme" for verification
+(grow-compress) verified contents of "testme"
+(grow-compress) close "testme"
+(grow-compress) open "testme"
+(grow-compress) overwrite "testme"
+(grow-compress) close "testme"
+(grow-compress) open "testme" for verification
+(grow-compress) verified contents of "testme"
+(grow-compress) close "testme"
+(grow-compress) compress bad fd
+(grow-compress) end
+EOF
+pass;
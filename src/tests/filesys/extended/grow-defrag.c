@@ -0,0 +1,51 @@
+/* Grows two files a sector at a time, alternately, so that their
+   blocks interleave, then defragments one of them while it is
+   open and checks that both still read back correctly. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 8192
+static char buf_a[FILE_SIZE];
+static char buf_b[FILE_SIZE];
+
+void test_main(void) {
+  int fd_a, fd_b;
+  int before, after;
+  size_t ofs;
+
+  random_init(0);
+  random_bytes(buf_a, sizeof buf_a);
+  random_bytes(buf_b, sizeof buf_b);
+
+  CHECK(create("a", 0), "create \"a\"");
+  CHECK(create("b", 0), "create \"b\"");
+  CHECK((fd_a = open("a")) > 1, "open \"a\"");
+  CHECK((fd_b = open("b")) > 1, "open \"b\"");
+
+  msg("write \"a\" and \"b\" alternately");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += 512) {
+    if (write(fd_a, buf_a + ofs, 512) != 512)
+      fail("write 512 bytes at offset %zu in \"a\" failed", ofs);
+    if (write(fd_b, buf_b + ofs, 512) != 512)
+      fail("write 512 bytes at offset %zu in \"b\" failed", ofs);
+  }
+
+  CHECK(defrag(fd_a, &before, &after), "defrag \"a\"");
+  if (before < 2)
+    fail("\"a\" was in %d extents before defrag, expected more than 1", before);
+  if (after != 1)
+    fail("\"a\" is in %d extents after defrag, expected 1", after);
+  seek(fd_a, 0);
+  check_file_handle(fd_a, "a", buf_a, FILE_SIZE);
+
+  msg("close \"a\"");
+  close(fd_a);
+  msg("close \"b\"");
+  close(fd_b);
+
+  check_file("a", buf_a, FILE_SIZE);
+  check_file("b", buf_b, FILE_SIZE);
+}
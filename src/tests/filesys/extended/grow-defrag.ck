@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-defrag) begin
+(grow-defrag) create "a"
+(grow-defrag) create "b"
+(grow-defrag) open "a"
+(grow-defrag) open "b"
+(grow-defrag) write "a" and "b" alternately
+(grow-defrag) defrag "a"
+(grow-defrag) verified contents of "a"
+(grow-defrag) close "a"
+(grow-defrag) close "b"
+(grow-defrag) open "a" for verification
+(grow-defrag) verified contents of "a"
+(grow-defrag) close "a"
+(grow-defrag) open "b" for verification
+(grow-defrag) verified contents of "b"
+(grow-defrag) close "b"
+(grow-defrag) end
+EOF
+pass;
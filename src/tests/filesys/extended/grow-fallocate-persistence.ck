@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_archive ({"testme" => ["\0" x 15000 . "fallocate" . "\0" x 4991]});
+pass;
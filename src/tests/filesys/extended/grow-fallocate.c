@@ -0,0 +1,33 @@
+/* Preallocates a file with fallocate(), checks that it reads
+   back as zeros, and writes into the preallocated space. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[20000];
+
+void test_main(void) {
+  const char* file_name = "testme";
+  const char* text = "fallocate";
+  int fd;
+
+  CHECK(create(file_name, 0), "create \"%s\"", file_name);
+  CHECK((fd = open(file_name)) > 1, "open \"%s\"", file_name);
+  CHECK(fallocate(fd, sizeof buf), "fallocate \"%s\"", file_name);
+  if (filesize(fd) != (int)sizeof buf)
+    fail("filesize is %d, expected %zu", filesize(fd), sizeof buf);
+  CHECK(fallocate(fd, 100), "fallocate smaller than file");
+  if (filesize(fd) != (int)sizeof buf)
+    fail("fallocate shrank file to %d bytes", filesize(fd));
+  check_file_handle(fd, file_name, buf, sizeof buf);
+
+  msg("seek \"%s\"", file_name);
+  seek(fd, 15000);
+  CHECK(write(fd, text, strlen(text)) == (int)strlen(text), "write \"%s\"", file_name);
+  memcpy(buf + 15000, text, strlen(text));
+  msg("close \"%s\"", file_name);
+  close(fd);
+  check_file(file_name, buf, sizeof buf);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-fallocate) begin
+(grow-fallocate) create "testme"
+(grow-fallocate) open "testme"
+(grow-fallocate) fallocate "testme"
+(grow-fallocate) fallocate smaller than file
+(grow-fallocate) verified contents of "testme"
+(grow-fallocate) seek "testme"
+(grow-fallocate) write "testme"
+(grow-fallocate) close "testme"
+(grow-fallocate) open "testme" for verification
+(grow-fallocate) verified contents of "testme"
+(grow-fallocate) close "testme"
+(grow-fallocate) end
+EOF
+pass;
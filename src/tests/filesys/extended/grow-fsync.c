@@ -0,0 +1,24 @@
+/* Grows a file, calling fsync() after each write, then checks
+   that fsync() rejects a bad file descriptor and that sync()
+   returns. */
+
+#include <syscall.h>
+#include "tests/filesys/seq-test.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[5678];
+
+static size_t return_block_size(void) { return 1234; }
+
+static void check_fsync(int fd, long ofs) {
+  if (!fsync(fd))
+    fail("fsync failed after writing %ld bytes", ofs);
+}
+
+void test_main(void) {
+  seq_test("testme", buf, sizeof buf, 0, return_block_size, check_fsync);
+  CHECK(!fsync(1234), "fsync bad fd");
+  msg("sync");
+  sync();
+}
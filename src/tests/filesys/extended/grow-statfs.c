@@ -0,0 +1,37 @@
+/* Checks that statfs() reports the space a growing file takes up. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[10240];
+
+void test_main(void) {
+  const char* file_name = "testme";
+  struct statfs before, after;
+  int fd;
+
+  random_bytes(buf, sizeof buf);
+  msg("statfs");
+  statfs(&before);
+  if (before.sector_size != 512)
+    fail("sector size is %d, expected 512", before.sector_size);
+  if (before.free_sectors <= 0 || before.free_sectors >= before.total_sectors)
+    fail("%d of %d sectors free", before.free_sectors, before.total_sectors);
+
+  CHECK(create(file_name, 0), "create \"%s\"", file_name);
+  CHECK((fd = open(file_name)) > 1, "open \"%s\"", file_name);
+  CHECK(write(fd, buf, sizeof buf) == (int)sizeof buf, "write \"%s\"", file_name);
+
+  msg("statfs");
+  statfs(&after);
+  if (after.total_sectors != before.total_sectors)
+    fail("total sectors changed from %d to %d", before.total_sectors, after.total_sectors);
+  if (before.free_sectors - after.free_sectors < (int)sizeof buf / 512)
+    fail("free sectors only went from %d to %d", before.free_sectors, after.free_sectors);
+
+  msg("close \"%s\"", file_name);
+  close(fd);
+  check_file(file_name, buf, sizeof buf);
+}
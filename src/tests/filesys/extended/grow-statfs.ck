@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-statfs) begin
+(grow-statfs) statfs
+(grow-statfs) create "testme"
+(grow-statfs) open "testme"
+(grow-statfs) write "testme"
+(grow-statfs) statfs
+(grow-statfs) close "testme"
+(grow-statfs) open "testme" for verification
+(grow-statfs) verified contents of "testme"
+(grow-statfs) close "testme"
+(grow-statfs) end
+EOF
+pass;
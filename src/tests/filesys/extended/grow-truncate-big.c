@@ -0,0 +1,42 @@
+/* Grows a file into the doubly indirect blocks, then shrinks it
+   with truncate() back below them and finally to nothing, and
+   checks with statfs() that every sector comes back. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[100000];
+
+void test_main(void) {
+  const char* file_name = "testme";
+  struct statfs before, after;
+  int fd;
+
+  random_bytes(buf, sizeof buf);
+  CHECK(create(file_name, 0), "create \"%s\"", file_name);
+  CHECK((fd = open(file_name)) > 1, "open \"%s\"", file_name);
+  msg("statfs");
+  statfs(&before);
+  CHECK(write(fd, buf, sizeof buf) == (int)sizeof buf, "write \"%s\"", file_name);
+
+  CHECK(truncate(fd, 80000), "truncate \"%s\" to 80000 bytes", file_name);
+  seek(fd, 0);
+  check_file_handle(fd, file_name, buf, 80000);
+
+  CHECK(truncate(fd, 20000), "truncate \"%s\" to 20000 bytes", file_name);
+  if (filesize(fd) != 20000)
+    fail("filesize is %d, expected 20000", filesize(fd));
+  seek(fd, 0);
+  check_file_handle(fd, file_name, buf, 20000);
+
+  CHECK(truncate(fd, 0), "truncate \"%s\" to 0 bytes", file_name);
+  msg("statfs");
+  statfs(&after);
+  if (after.free_sectors != before.free_sectors)
+    fail("free sectors went from %d to %d", before.free_sectors, after.free_sectors);
+
+  msg("close \"%s\"", file_name);
+  close(fd);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-truncate-big) begin
+(grow-truncate-big) create "testme"
+(grow-truncate-big) open "testme"
+(grow-truncate-big) statfs
+(grow-truncate-big) write "testme"
+(grow-truncate-big) truncate "testme" to 80000 bytes
+(grow-truncate-big) verified contents of "testme"
+(grow-truncate-big) truncate "testme" to 20000 bytes
+(grow-truncate-big) verified contents of "testme"
+(grow-truncate-big) truncate "testme" to 0 bytes
+(grow-truncate-big) statfs
+(grow-truncate-big) close "testme"
+(grow-truncate-big) end
+EOF
+pass;
@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+check_archive ({"testme" => [substr (random_bytes (10000), 0, 3000) . "\0" x 2000]});
+pass;
@@ -0,0 +1,32 @@
+/* Shrinks a file with truncate(), then grows it again and checks
+   that the regrown part reads back as zeros. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[10000];
+
+void test_main(void) {
+  const char* file_name = "testme";
+  int fd;
+
+  random_bytes(buf, sizeof buf);
+  CHECK(create(file_name, 0), "create \"%s\"", file_name);
+  CHECK((fd = open(file_name)) > 1, "open \"%s\"", file_name);
+  CHECK(write(fd, buf, sizeof buf) == (int)sizeof buf, "write \"%s\"", file_name);
+
+  CHECK(truncate(fd, 3000), "truncate \"%s\" to 3000 bytes", file_name);
+  if (filesize(fd) != 3000)
+    fail("filesize is %d, expected 3000", filesize(fd));
+  seek(fd, 0);
+  check_file_handle(fd, file_name, buf, 3000);
+
+  CHECK(truncate(fd, 5000), "truncate \"%s\" to 5000 bytes", file_name);
+  memset(buf + 3000, 0, 2000);
+  msg("close \"%s\"", file_name);
+  close(fd);
+  check_file(file_name, buf, 5000);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-truncate) begin
+(grow-truncate) create "testme"
+(grow-truncate) open "testme"
+(grow-truncate) write "testme"
+(grow-truncate) truncate "testme" to 3000 bytes
+(grow-truncate) verified contents of "testme"
+(grow-truncate) truncate "testme" to 5000 bytes
+(grow-truncate) close "testme"
+(grow-truncate) open "testme" for verification
+(grow-truncate) verified contents of "testme"
+(grow-truncate) close "testme"
+(grow-truncate) end
+EOF
+pass;
@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+check_archive ({"sample.txt" => "tests/userprog/sample.txt",
+		"testme" => [random_bytes (20000)]});
+pass;
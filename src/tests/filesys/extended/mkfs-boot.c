@@ -0,0 +1,33 @@
+/* Runs from a file system image that pintos-mkfs built on the
+   host, instead of one the kernel formatted, and checks that the
+   files it copied in read back and that new files can be
+   allocated from the free map it wrote. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[20000];
+
+void test_main(void) {
+  const char* file_name = "testme";
+  struct statfs st;
+  int fd;
+
+  check_file("sample.txt", sample, sizeof sample - 1);
+
+  msg("statfs");
+  statfs(&st);
+  if (st.free_sectors <= 0 || st.free_sectors >= st.total_sectors)
+    fail("%d of %d sectors free", st.free_sectors, st.total_sectors);
+
+  random_bytes(buf, sizeof buf);
+  CHECK(create(file_name, 0), "create \"%s\"", file_name);
+  CHECK((fd = open(file_name)) > 1, "open \"%s\"", file_name);
+  CHECK(write(fd, buf, sizeof buf) == (int)sizeof buf, "write \"%s\"", file_name);
+  msg("close \"%s\"", file_name);
+  close(fd);
+  check_file(file_name, buf, sizeof buf);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mkfs-boot) begin
+(mkfs-boot) open "sample.txt" for verification
+(mkfs-boot) verified contents of "sample.txt"
+(mkfs-boot) close "sample.txt"
+(mkfs-boot) statfs
+(mkfs-boot) create "testme"
+(mkfs-boot) open "testme"
+(mkfs-boot) write "testme"
+(mkfs-boot) close "testme"
+(mkfs-boot) open "testme" for verification
+(mkfs-boot) verified contents of "testme"
+(mkfs-boot) close "testme"
+(mkfs-boot) end
+EOF
+pass;
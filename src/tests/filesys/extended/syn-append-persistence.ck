@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_archive ({"child-syn-append" => "tests/filesys/extended/child-syn-append"});
+pass;
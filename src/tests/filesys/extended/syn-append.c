@@ -0,0 +1,43 @@
+/* Has several subprocesses append fixed-size records to one file
+   opened in append mode, then checks that every record landed
+   whole, none overwrote another, and the file has the combined
+   length. */
+
+#include <syscall.h>
+#include "tests/filesys/extended/syn-append.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[BUF_SIZE];
+
+void test_main(void) {
+  pid_t children[CHILD_CNT];
+  int counts[CHILD_CNT] = {0};
+  int fd, i, j;
+
+  CHECK(create(file_name, 0), "create \"%s\"", file_name);
+  exec_children("child-syn-append", children, CHILD_CNT);
+  wait_children(children, CHILD_CNT);
+
+  CHECK((fd = open(file_name)) > 1, "open \"%s\"", file_name);
+  if (filesize(fd) != BUF_SIZE)
+    fail("\"%s\" is %d bytes, expected %d", file_name, filesize(fd), BUF_SIZE);
+  CHECK(read(fd, buf, BUF_SIZE) == BUF_SIZE, "read \"%s\"", file_name);
+  close(fd);
+
+  for (i = 0; i < BUF_SIZE; i += RECORD_SIZE) {
+    int child_idx = buf[i] - 'a';
+    if (child_idx < 0 || child_idx >= CHILD_CNT)
+      fail("record at offset %d has bad tag %d", i, buf[i]);
+    for (j = 1; j < RECORD_SIZE; j++)
+      if (buf[i + j] != buf[i])
+        fail("record at offset %d is torn at byte %d", i, j);
+    counts[child_idx]++;
+  }
+  for (i = 0; i < CHILD_CNT; i++)
+    if (counts[i] != RECORD_CNT)
+      fail("child %d appended %d records, expected %d", i, counts[i], RECORD_CNT);
+  msg("all records intact");
+
+  CHECK(remove(file_name), "remove \"%s\"", file_name);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(syn-append) begin
+(syn-append) create "logfile"
+(syn-append) exec child 1 of 4: "child-syn-append 0"
+(syn-append) exec child 2 of 4: "child-syn-append 1"
+(syn-append) exec child 3 of 4: "child-syn-append 2"
+(syn-append) exec child 4 of 4: "child-syn-append 3"
+(syn-append) wait for child 1 of 4 returned 0 (expected 0)
+(syn-append) wait for child 2 of 4 returned 1 (expected 1)
+(syn-append) wait for child 3 of 4 returned 2 (expected 2)
+(syn-append) wait for child 4 of 4 returned 3 (expected 3)
+(syn-append) open "logfile"
+(syn-append) read "logfile"
+(syn-append) all records intact
+(syn-append) remove "logfile"
+(syn-append) end
+EOF
+pass;
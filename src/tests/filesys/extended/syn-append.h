@@ -0,0 +1,10 @@
+#ifndef TESTS_FILESYS_EXTENDED_SYN_APPEND_H
+#define TESTS_FILESYS_EXTENDED_SYN_APPEND_H
+
+#define CHILD_CNT 4
+#define RECORD_SIZE 64
+#define RECORD_CNT 16
+#define BUF_SIZE (CHILD_CNT * RECORD_CNT * RECORD_SIZE)
+static const char file_name[] = "logfile";
+
+#endif /* tests/filesys/extended/syn-append.h */
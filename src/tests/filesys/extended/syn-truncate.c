@@ -0,0 +1,69 @@
+/* Truncates a file to nothing, over and over, while subprocesses
+   append records to it, and writes a new file after each truncate
+   so that it takes the sectors the truncate freed.  Checks that
+   no append landed in those sectors after they were freed, and
+   that the log holds only whole records. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/filesys/extended/syn-truncate.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define VICTIM_CNT 8
+
+static char buf[BUF_SIZE];
+
+void test_main(void) {
+  pid_t children[CHILD_CNT];
+  char name[16];
+  int fd, victim_fd, size, i, j;
+
+  CHECK(create(file_name, 0), "create \"%s\"", file_name);
+  CHECK((fd = open(file_name)) > 1, "open \"%s\"", file_name);
+  exec_children("child-trunc", children, CHILD_CNT);
+
+  for (i = 0; i < VICTIM_CNT; i++) {
+    if (!truncate(fd, 0))
+      fail("truncate \"%s\" failed", file_name);
+    snprintf(name, sizeof name, "victim%d", i);
+    memset(buf, 'A' + i, RECORD_SIZE);
+    if (!create(name, 0) || (victim_fd = open(name)) < 2)
+      fail("create \"%s\" failed", name);
+    if (write(victim_fd, buf, RECORD_SIZE) != RECORD_SIZE)
+      fail("write \"%s\" failed", name);
+    close(victim_fd);
+  }
+  msg("truncated \"%s\" %d times", file_name, VICTIM_CNT);
+  wait_children(children, CHILD_CNT);
+
+  for (i = 0; i < VICTIM_CNT; i++) {
+    snprintf(name, sizeof name, "victim%d", i);
+    if ((victim_fd = open(name)) < 2 || read(victim_fd, buf, RECORD_SIZE) != RECORD_SIZE)
+      fail("read \"%s\" failed", name);
+    for (j = 0; j < RECORD_SIZE; j++)
+      if (buf[j] != 'A' + i)
+        fail("\"%s\" was overwritten at byte %d", name, j);
+    close(victim_fd);
+    remove(name);
+  }
+  msg("all victims intact");
+
+  seek(fd, 0);
+  size = filesize(fd);
+  if (size % RECORD_SIZE != 0 || size > BUF_SIZE)
+    fail("\"%s\" is %d bytes, not a whole number of records", file_name, size);
+  CHECK(read(fd, buf, size) == size, "read \"%s\"", file_name);
+  close(fd);
+  for (i = 0; i < size; i += RECORD_SIZE) {
+    if (buf[i] < 'a' || buf[i] >= 'a' + CHILD_CNT)
+      fail("record at offset %d has bad tag %d", i, buf[i]);
+    for (j = 1; j < RECORD_SIZE; j++)
+      if (buf[i + j] != buf[i])
+        fail("record at offset %d is torn at byte %d", i, j);
+  }
+  msg("all records intact");
+
+  CHECK(remove(file_name), "remove \"%s\"", file_name);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(syn-truncate) begin
+(syn-truncate) create "logfile"
+(syn-truncate) open "logfile"
+(syn-truncate) exec child 1 of 2: "child-trunc 0"
+(syn-truncate) exec child 2 of 2: "child-trunc 1"
+(syn-truncate) truncated "logfile" 8 times
+(syn-truncate) wait for child 1 of 2 returned 0 (expected 0)
+(syn-truncate) wait for child 2 of 2 returned 1 (expected 1)
+(syn-truncate) all victims intact
+(syn-truncate) read "logfile"
+(syn-truncate) all records intact
+(syn-truncate) remove "logfile"
+(syn-truncate) end
+EOF
+pass;
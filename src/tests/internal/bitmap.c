@@ -0,0 +1,117 @@
+/* Test program for lib/kernel/bitmap.c.
+
+   Checks the word-at-a-time bitmap_scan(), bitmap_count() and
+   bitmap_contains() against simple bit-at-a-time versions on
+   random bitmaps, then times bitmap_scan() against the
+   bit-at-a-time scan that it replaced.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <random.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Number of bits in the bitmaps tested. */
+#define BIT_CNT 4096
+
+/* Number of scans timed for each implementation. */
+#define SCAN_CNT 200
+
+static void fill(struct bitmap*, int density);
+static size_t ref_count(const struct bitmap*, size_t start, size_t cnt, bool);
+static bool ref_contains(const struct bitmap*, size_t start, size_t cnt, bool);
+static size_t ref_scan(const struct bitmap*, size_t start, size_t cnt, bool);
+
+/* Test and time the bitmap implementation. */
+void test(void) {
+  struct bitmap* b = bitmap_create(BIT_CNT);
+  int density, i;
+
+  ASSERT(b != NULL);
+  printf("testing bitmaps of various densities:");
+  for (density = 0; density <= 100; density += 10) {
+    printf(" %d%%", density);
+    for (i = 0; i < 200; i++) {
+      size_t start = random_ulong() % (BIT_CNT + 1);
+      size_t cnt = random_ulong() % (BIT_CNT - start + 1) % 100;
+      bool value = random_ulong() % 2;
+
+      fill(b, density);
+      ASSERT(bitmap_count(b, start, cnt, value) == ref_count(b, start, cnt, value));
+      ASSERT(bitmap_contains(b, start, cnt, value) == ref_contains(b, start, cnt, value));
+      ASSERT(bitmap_scan(b, start, cnt, value) == ref_scan(b, start, cnt, value));
+    }
+  }
+  printf(" done\n");
+
+  /* A mostly full bitmap with one free run near the end is the
+     worst case for the bit-at-a-time scan. */
+  bitmap_set_all(b, true);
+  bitmap_set_multiple(b, BIT_CNT - 64, 64, false);
+  for (i = 0; i < 2; i++) {
+    int64_t start = timer_ticks();
+    int j;
+
+    for (j = 0; j < SCAN_CNT; j++)
+      ASSERT((i == 0 ? bitmap_scan(b, 0, 64, false) : ref_scan(b, 0, 64, false)) ==
+             BIT_CNT - 64);
+    printf("%s scan: %d scans in %lld ticks\n", i == 0 ? "word" : "bit", SCAN_CNT,
+           timer_elapsed(start));
+  }
+
+  bitmap_destroy(b);
+  printf("bitmap: PASS\n");
+}
+
+/* Sets each bit in B to true with probability DENSITY percent,
+   in runs so that scans see runs of both values. */
+static void fill(struct bitmap* b, int density) {
+  size_t i = 0;
+
+  while (i < BIT_CNT) {
+    size_t len = random_ulong() % 80 + 1;
+    bool value = (int)(random_ulong() % 100) < density;
+    if (len > BIT_CNT - i)
+      len = BIT_CNT - i;
+    bitmap_set_multiple(b, i, len, value);
+    i += len;
+  }
+}
+
+/* Bit-at-a-time bitmap_count(). */
+static size_t ref_count(const struct bitmap* b, size_t start, size_t cnt, bool value) {
+  size_t i, value_cnt = 0;
+
+  for (i = 0; i < cnt; i++)
+    if (bitmap_test(b, start + i) == value)
+      value_cnt++;
+  return value_cnt;
+}
+
+/* Bit-at-a-time bitmap_contains(). */
+static bool ref_contains(const struct bitmap* b, size_t start, size_t cnt, bool value) {
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    if (bitmap_test(b, start + i) == value)
+      return true;
+  return false;
+}
+
+/* The bitmap_scan() that tests every starting bit. */
+static size_t ref_scan(const struct bitmap* b, size_t start, size_t cnt, bool value) {
+  if (cnt <= bitmap_size(b)) {
+    size_t last = bitmap_size(b) - cnt;
+    size_t i;
+    for (i = start; i <= last; i++)
+      if (!ref_contains(b, i, cnt, !value))
+        return i;
+  }
+  return BITMAP_ERROR;
+}
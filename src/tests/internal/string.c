@@ -0,0 +1,186 @@
+/* Test program for the memory and string functions in
+   lib/string.c.
+
+   Checks memcpy(), memmove(), memset(), memcmp() and strlen()
+   against simple byte-at-a-time versions for many sizes and
+   alignments, including overlapping moves in both directions,
+   then times 512-byte and 4 kB copies and fills against the
+   byte-at-a-time loops that they replaced.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/test.h"
+#include "threads/vaddr.h"
+
+/* Number of random checks of each function. */
+#define CHECK_CNT 2000
+
+/* Number of calls timed for each size. */
+#define TIME_CNT 20000
+
+static uint8_t* buf;  /* Buffer operated on. */
+static uint8_t* copy; /* Expected contents of BUF. */
+
+static void check(void);
+static void time_size(size_t size);
+static void* ref_memcpy(void*, const void*, size_t);
+static void* ref_memmove(void*, const void*, size_t);
+static void* ref_memset(void*, int, size_t);
+static int ref_memcmp(const void*, const void*, size_t);
+static size_t ref_strlen(const char*);
+
+/* Test and time the string functions. */
+void test(void) {
+  buf = palloc_get_multiple(PAL_ASSERT, 2);
+  copy = palloc_get_multiple(PAL_ASSERT, 2);
+
+  check();
+  time_size(512);
+  time_size(PGSIZE);
+
+  palloc_free_multiple(buf, 2);
+  palloc_free_multiple(copy, 2);
+  printf("string: PASS\n");
+}
+
+/* Returns a random number in [0, N). */
+static size_t rand_below(size_t n) { return random_ulong() % n; }
+
+/* Checks each function against its reference version on random
+   blocks within the first page of BUF. */
+static void check(void) {
+  int i;
+
+  printf("checking memcpy, memmove, memset, memcmp and strlen...");
+  for (i = 0; i < CHECK_CNT; i++) {
+    size_t size = rand_below(i % 2 ? 64 : PGSIZE / 2);
+    size_t dst = rand_below(PGSIZE / 2);
+    size_t src = rand_below(PGSIZE / 2);
+    size_t j;
+    int value = random_ulong();
+
+    for (j = 0; j < 2 * PGSIZE; j++)
+      buf[j] = copy[j] = random_ulong();
+
+    /* memcpy() from the second page, so the blocks don't overlap. */
+    ASSERT(memcpy(buf + dst, buf + PGSIZE + src, size) == buf + dst);
+    ref_memcpy(copy + dst, copy + PGSIZE + src, size);
+    ASSERT(!ref_memcmp(buf, copy, 2 * PGSIZE));
+
+    /* memmove() within the first page, so the blocks may overlap. */
+    ASSERT(memmove(buf + dst, buf + src, size) == buf + dst);
+    ref_memmove(copy + dst, copy + src, size);
+    ASSERT(!ref_memcmp(buf, copy, 2 * PGSIZE));
+
+    ASSERT(memset(buf + dst, value, size) == buf + dst);
+    ref_memset(copy + dst, value, size);
+    ASSERT(!ref_memcmp(buf, copy, 2 * PGSIZE));
+
+    /* memcmp() of equal blocks, then with one byte changed. */
+    memcpy(buf + PGSIZE + src, buf + dst, size);
+    ASSERT(memcmp(buf + dst, buf + PGSIZE + src, size) == 0);
+    if (size > 0) {
+      j = rand_below(size);
+      buf[PGSIZE + src + j] ^= rand_below(255) + 1;
+      ASSERT(memcmp(buf + dst, buf + PGSIZE + src, size) ==
+             ref_memcmp(buf + dst, buf + PGSIZE + src, size));
+    }
+
+    /* strlen() of a string of SIZE nonnull bytes. */
+    for (j = 0; j < size; j++)
+      if (buf[dst + j] == '\0')
+        buf[dst + j] = 'x';
+    buf[dst + size] = '\0';
+    ASSERT(strlen((char*)buf + dst) == size);
+    ASSERT(ref_strlen((char*)buf + dst) == size);
+  }
+  printf(" done\n");
+}
+
+/* Times TIME_CNT copies and fills of SIZE bytes with the library
+   and the reference functions. */
+static void time_size(size_t size) {
+  int i, j;
+
+  for (i = 0; i < 2; i++) {
+    int64_t start = timer_ticks();
+    for (j = 0; j < TIME_CNT; j++)
+      (i == 0 ? memcpy : ref_memcpy)(buf, buf + PGSIZE, size);
+    printf("%s memcpy: %d copies of %zu bytes in %lld ticks\n", i == 0 ? "word" : "byte", TIME_CNT,
+           size, timer_elapsed(start));
+  }
+
+  for (i = 0; i < 2; i++) {
+    int64_t start = timer_ticks();
+    for (j = 0; j < TIME_CNT; j++)
+      (i == 0 ? memset : ref_memset)(buf, j, size);
+    printf("%s memset: %d fills of %zu bytes in %lld ticks\n", i == 0 ? "word" : "byte", TIME_CNT,
+           size, timer_elapsed(start));
+  }
+}
+
+/* Byte-at-a-time memcpy(). */
+static void* ref_memcpy(void* dst_, const void* src_, size_t size) {
+  uint8_t* dst = dst_;
+  const uint8_t* src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+  return dst_;
+}
+
+/* Byte-at-a-time memmove(). */
+static void* ref_memmove(void* dst_, const void* src_, size_t size) {
+  uint8_t* dst = dst_;
+  const uint8_t* src = src_;
+
+  if (dst < src) {
+    while (size-- > 0)
+      *dst++ = *src++;
+  } else {
+    dst += size;
+    src += size;
+    while (size-- > 0)
+      *--dst = *--src;
+  }
+  return dst_;
+}
+
+/* Byte-at-a-time memset(). */
+static void* ref_memset(void* dst_, int value, size_t size) {
+  uint8_t* dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+  return dst_;
+}
+
+/* Byte-at-a-time memcmp(). */
+static int ref_memcmp(const void* a_, const void* b_, size_t size) {
+  const uint8_t* a = a_;
+  const uint8_t* b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+/* Byte-at-a-time strlen(). */
+static size_t ref_strlen(const char* string) {
+  const char* p;
+
+  for (p = string; *p != '\0'; p++)
+    continue;
+  return p - string;
+}
@@ -20,8 +20,10 @@
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
+#include "threads/memprof.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -34,6 +36,12 @@
 #ifdef THREADS
 #include "tests/threads/tests.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/share.h"
+#include "vm/swap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
@@ -97,6 +105,8 @@ int main(void) {
   /* Initialize memory system. */
   palloc_init(user_page_limit);
   malloc_init();
+  slab_init();
+  memprof_init();
   paging_init();
 
   /* Segmentation. */
@@ -132,6 +142,14 @@ int main(void) {
   filesys_init(format_filesys);
 #endif
 
+#ifdef VM
+  /* Initialize virtual memory. */
+  page_init();
+  frame_init();
+  share_init();
+  swap_init();
+#endif
+
   printf("Boot complete.\n");
 
   /* Run actions specified on kernel command line. */
@@ -249,6 +267,8 @@ static char** parse_options(char** argv) {
 #endif
     else if (!strcmp(name, "-rs"))
       random_init(atoi(value));
+    else if (!strcmp(name, "-mprof"))
+      memprof_enabled = true;
     else if (!strcmp(name, "-sched")) {
       if (!strcmp(value, "fifo"))
         scheduler_flags[SCHED_FIFO] = 1;
@@ -366,6 +386,8 @@ static void run_actions(char** argv) {
       {"rm", 2, fsutil_rm},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
+      {"compress-bench", 1, fsutil_compress_bench},
+      {"defrag", 2, fsutil_defrag},
 #endif
       {NULL, 0, NULL},
   };
@@ -413,6 +435,8 @@ static void usage(void) {
          "Use these actions indirectly via `pintos' -g and -p options:\n"
          "  extract            Untar from scratch device into file system.\n"
          "  append FILE        Append FILE to tar file on scratch device.\n"
+         "  compress-bench     Compare reading a compressed and a raw file.\n"
+         "  defrag FILE        Move FILE's blocks into one contiguous run.\n"
 #endif
          "\nOptions:\n"
          "  -h                 Print this help message and power off.\n"
@@ -427,6 +451,7 @@ static void usage(void) {
 #endif // VM
 #endif // FILESYS
          "  -rs=SEED           Set random number seed to SEED.\n"
+         "  -mprof             Track kernel allocations by call site.\n"
          "  -sched-fair        Use alternate non-strict priority scheduler. Mutually exclusive "
          "with \"-sched-mlfqs\", \"-sched-prio\".\n"
          "  -sched-mlfqs       Use multi-level feedback queue scheduler. Mutually exclusive with "
@@ -5,19 +5,28 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/memprof.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
+   The size of each request, in bytes, is rounded up to the
+   next size class and assigned to the "descriptor" that manages
+   blocks of that size.  Size classes are about 1.25x apart,
+   rounded up to multiples of 16 bytes, so a block of 240 bytes
+   or more wastes no more than about a fifth of its size.  The
+   rounding makes the smaller classes (16 through 192 bytes)
+   coarser, wasting up to nearly half of a 32-byte block.
+   The descriptor keeps a list of free blocks.  If the free list
+   is nonempty, one of its blocks is used to satisfy the
+   request.
+
+   Otherwise, a new run of pages, called an "arena", is
    obtained from the page allocator (if none is available,
    malloc() returns a null pointer).  The new arena is divided
    into blocks, all of which are added to the descriptor's free
@@ -28,18 +37,37 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   An arena is one page for small blocks.  Bigger blocks would
+   leave a large part of a page unused, so their arenas span 2,
+   4 or 8 pages, enough to hold at least 8 blocks.  A block can
+   then start on any page of its arena, so for each page of RAM
+   we record how far it lies past the start of its arena.
+
+   We can't handle blocks bigger than the largest size class
+   using this scheme.  We handle those by allocating contiguous
+   pages with the page allocator and sticking the allocation
+   size at the beginning of the allocated block's arena header.
+
+   Taking a descriptor's lock on every call is expensive, so
+   each thread also keeps a "magazine" of free blocks per
+   descriptor in its struct thread.  malloc() pops from the
+   running thread's magazine and free() pushes onto it, neither
+   of which needs a lock because no other thread touches it.
+   An empty magazine is refilled, and a full one half drained,
+   in a single batch under the descriptor's lock.  Blocks in a
+   magazine still count as in use by their arenas, so a thread
+   returns everything it has cached when it exits. */
 
 /* Descriptor. */
 struct desc {
   size_t block_size;       /* Size of each element in bytes. */
+  size_t arena_pages;      /* Number of pages in an arena. */
   size_t blocks_per_arena; /* Number of blocks in an arena. */
+  size_t mag_size;         /* Capacity of a thread's magazine. */
   struct list free_list;   /* List of free blocks. */
   struct lock lock;        /* Lock. */
+  size_t arena_cnt;        /* Number of arenas. */
+  size_t free_cnt;         /* Number of blocks in FREE_LIST. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -55,33 +83,74 @@ struct arena {
 /* Free block. */
 struct block {
   struct list_elem free_elem; /* Free list element. */
+  struct block* mag_next;     /* Next block in a magazine. */
 };
 
+/* Most blocks a thread caches per descriptor.  Also capped at
+   about a page's worth so big size classes do not pin pages. */
+#define MAG_SIZE 16
+
+/* An arena holds at least this many blocks, */
+#define MIN_ARENA_BLOCKS 8
+
+/* ...unless that would take more than this many pages. */
+#define MAX_ARENA_PAGES 8
+
 /* Our set of descriptors. */
-static struct desc descs[10]; /* Descriptors. */
-static size_t desc_cnt;       /* Number of descriptors. */
+static struct desc descs[MALLOC_CLASS_CNT]; /* Descriptors. */
+static size_t desc_cnt;                     /* Number of descriptors. */
+
+/* For each page of RAM, the number of pages it lies past the
+   start of the arena that contains it.  Zero for pages that are
+   not in a multi-page arena. */
+static uint8_t* arena_ofs;
 
+static void* malloc_block(size_t size);
 static struct arena* block_to_arena(struct block*);
 static struct block* arena_to_block(struct arena*, size_t idx);
+static bool refill_magazine(struct desc*, struct magazine*);
+static void drain_magazine(struct desc*, struct magazine*, size_t cnt);
 
 /* Initializes the malloc() descriptors. */
 void malloc_init(void) {
   size_t block_size;
 
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
+  arena_ofs = palloc_get_multiple(PAL_ASSERT | PAL_ZERO, DIV_ROUND_UP(init_ram_pages, PGSIZE));
+
+  /* Create size classes about 1.25x apart, up to the first one
+     that can hold a full page. */
+  for (block_size = 16;; block_size = ROUND_UP(block_size * 5 / 4, 16)) {
     struct desc* d = &descs[desc_cnt++];
     ASSERT(desc_cnt <= sizeof descs / sizeof *descs);
     d->block_size = block_size;
-    d->blocks_per_arena = (PGSIZE - sizeof(struct arena)) / block_size;
+    d->arena_pages = 1;
+    while ((d->arena_pages * PGSIZE - sizeof(struct arena)) / block_size < MIN_ARENA_BLOCKS &&
+           d->arena_pages < MAX_ARENA_PAGES)
+      d->arena_pages *= 2;
+    d->blocks_per_arena = (d->arena_pages * PGSIZE - sizeof(struct arena)) / block_size;
+    d->mag_size = d->blocks_per_arena < MAG_SIZE ? d->blocks_per_arena : MAG_SIZE;
+    if (d->mag_size > PGSIZE / block_size)
+      d->mag_size = PGSIZE / block_size > 0 ? PGSIZE / block_size : 1;
     list_init(&d->free_list);
     lock_init(&d->lock);
+    d->arena_cnt = d->free_cnt = 0;
+    if (block_size >= PGSIZE)
+      break;
   }
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void* malloc(size_t size) {
+  void* p = malloc_block(size);
+  memprof_alloc(MEMPROF_MALLOC, p, size, __builtin_return_address(0));
+  return p;
+}
+
+/* Does the work of malloc(), without profiling. */
+static void* malloc_block(size_t size) {
   struct desc* d;
+  struct magazine* m;
   struct block* b;
   struct arena* a;
 
@@ -110,34 +179,15 @@ void* malloc(size_t size) {
     return a + 1;
   }
 
-  lock_acquire(&d->lock);
-
-  /* If the free list is empty, create a new arena. */
-  if (list_empty(&d->free_list)) {
-    size_t i;
-
-    /* Allocate a page. */
-    a = palloc_get_page(0);
-    if (a == NULL) {
-      lock_release(&d->lock);
-      return NULL;
-    }
-
-    /* Initialize arena and add its blocks to the free list. */
-    a->magic = ARENA_MAGIC;
-    a->desc = d;
-    a->free_cnt = d->blocks_per_arena;
-    for (i = 0; i < d->blocks_per_arena; i++) {
-      struct block* b = arena_to_block(a, i);
-      list_push_back(&d->free_list, &b->free_elem);
-    }
-  }
-
-  /* Get a block from free list and return it. */
-  b = list_entry(list_pop_front(&d->free_list), struct block, free_elem);
-  a = block_to_arena(b);
-  a->free_cnt--;
-  lock_release(&d->lock);
+  /* Take a block from the running thread's magazine, first
+     refilling it from the descriptor if it is empty. */
+  ASSERT(!intr_context());
+  m = &thread_current()->magazines[d - descs];
+  if (m->cnt == 0 && !refill_magazine(d, m))
+    return NULL;
+  b = m->top;
+  m->top = b->mag_next;
+  m->cnt--;
   return b;
 }
 
@@ -153,7 +203,8 @@ void* calloc(size_t a, size_t b) {
     return NULL;
 
   /* Allocate and zero memory. */
-  p = malloc(size);
+  p = malloc_block(size);
+  memprof_alloc(MEMPROF_MALLOC, p, size, __builtin_return_address(0));
   if (p != NULL)
     memset(p, 0, size);
 
@@ -180,7 +231,8 @@ void* realloc(void* old_block, size_t new_size) {
     free(old_block);
     return NULL;
   } else {
-    void* new_block = malloc(new_size);
+    void* new_block = malloc_block(new_size);
+    memprof_alloc(MEMPROF_MALLOC, new_block, new_size, __builtin_return_address(0));
     if (old_block != NULL && new_block != NULL) {
       size_t old_size = block_size(old_block);
       size_t min_size = new_size < old_size ? new_size : old_size;
@@ -194,6 +246,7 @@ void* realloc(void* old_block, size_t new_size) {
 /* Frees block P, which must have been previously allocated with
    malloc(), calloc(), or realloc(). */
 void free(void* p) {
+  memprof_free(p);
   if (p != NULL) {
     struct block* b = p;
     struct arena* a = block_to_arena(b);
@@ -207,42 +260,149 @@ void free(void* p) {
       memset(b, 0xcc, d->block_size);
 #endif
 
-      lock_acquire(&d->lock);
+      /* Cache the block in the running thread's magazine,
+         draining half of it first if it is full. */
+      ASSERT(!intr_context());
+      struct magazine* m = &thread_current()->magazines[d - descs];
+      if (m->cnt >= d->mag_size)
+        drain_magazine(d, m, (m->cnt + 1) / 2);
+      b->mag_next = m->top;
+      m->top = b;
+      m->cnt++;
+    } else {
+      /* It's a big block.  Free its pages. */
+      palloc_free_multiple(a, a->free_cnt);
+      return;
+    }
+  }
+}
 
-      /* Add block to free list. */
-      list_push_front(&d->free_list, &b->free_elem);
+/* Prints how much of the memory held in arenas is in use, per
+   size class.  Blocks cached in threads' magazines count as in
+   use. */
+void malloc_print_stats(void) {
+  size_t held = 0, used = 0;
+  struct desc* d;
 
-      /* If the arena is now entirely unused, free it. */
-      if (++a->free_cnt >= d->blocks_per_arena) {
-        size_t i;
+  for (d = descs; d < descs + desc_cnt; d++) {
+    size_t d_held = d->arena_cnt * d->arena_pages * PGSIZE;
+    size_t d_used = (d->arena_cnt * d->blocks_per_arena - d->free_cnt) * d->block_size;
+    if (d->arena_cnt == 0)
+      continue;
+    printf("Malloc %zu-byte blocks: %zu arenas of %zu pages, %zu of %zu bytes in use\n",
+           d->block_size, d->arena_cnt, d->arena_pages, d_used, d_held);
+    held += d_held;
+    used += d_used;
+  }
+  printf("Malloc: %zu kB in arenas, %zu kB in use, %zu%% wasted\n", held / 1024, used / 1024,
+         held > 0 ? (held - used) * 100 / held : 0);
+}
 
-        ASSERT(a->free_cnt == d->blocks_per_arena);
-        for (i = 0; i < d->blocks_per_arena; i++) {
-          struct block* b = arena_to_block(a, i);
-          list_remove(&b->free_elem);
-        }
-        palloc_free_page(a);
-      }
+/* Returns all of the running thread's cached blocks to their
+   descriptors.  Called by thread_exit(). */
+void malloc_thread_exit(void) {
+  struct thread* t = thread_current();
+  size_t i;
+
+  for (i = 0; i < desc_cnt; i++)
+    if (t->magazines[i].cnt > 0)
+      drain_magazine(&descs[i], &t->magazines[i], t->magazines[i].cnt);
+}
+
+/* Moves up to half of D's magazine capacity of free blocks from
+   D's free list into magazine M, creating a new arena if D has
+   no free blocks.  Returns false if memory is not available. */
+static bool refill_magazine(struct desc* d, struct magazine* m) {
+  size_t batch = (d->mag_size + 1) / 2;
+
+  lock_acquire(&d->lock);
+
+  /* If the free list is empty, create a new arena. */
+  if (list_empty(&d->free_list)) {
+    struct arena* a;
+    size_t i;
 
+    /* Allocate the arena's pages. */
+    a = palloc_get_multiple(0, d->arena_pages);
+    if (a == NULL) {
       lock_release(&d->lock);
-    } else {
-      /* It's a big block.  Free its pages. */
-      palloc_free_multiple(a, a->free_cnt);
-      return;
+      return false;
+    }
+    for (i = 1; i < d->arena_pages; i++)
+      arena_ofs[vtop(a) / PGSIZE + i] = i;
+
+    /* Initialize arena and add its blocks to the free list. */
+    a->magic = ARENA_MAGIC;
+    a->desc = d;
+    a->free_cnt = d->blocks_per_arena;
+    for (i = 0; i < d->blocks_per_arena; i++) {
+      struct block* b = arena_to_block(a, i);
+      list_push_back(&d->free_list, &b->free_elem);
+    }
+    d->arena_cnt++;
+    d->free_cnt += d->blocks_per_arena;
+  }
+
+  /* Move blocks from the free list into the magazine. */
+  while (batch-- > 0 && !list_empty(&d->free_list)) {
+    struct block* b = list_entry(list_pop_front(&d->free_list), struct block, free_elem);
+    block_to_arena(b)->free_cnt--;
+    d->free_cnt--;
+    b->mag_next = m->top;
+    m->top = b;
+    m->cnt++;
+  }
+
+  lock_release(&d->lock);
+  return true;
+}
+
+/* Returns CNT blocks from the top of magazine M to D's free
+   list, giving back any arena that becomes entirely unused. */
+static void drain_magazine(struct desc* d, struct magazine* m, size_t cnt) {
+  ASSERT(cnt <= m->cnt);
+
+  lock_acquire(&d->lock);
+  while (cnt-- > 0) {
+    struct block* b = m->top;
+    struct arena* a = block_to_arena(b);
+    m->top = b->mag_next;
+    m->cnt--;
+
+    /* Add block to free list. */
+    list_push_front(&d->free_list, &b->free_elem);
+    d->free_cnt++;
+
+    /* If the arena is now entirely unused, free it. */
+    if (++a->free_cnt >= d->blocks_per_arena) {
+      size_t i;
+
+      ASSERT(a->free_cnt == d->blocks_per_arena);
+      for (i = 0; i < d->blocks_per_arena; i++) {
+        struct block* b = arena_to_block(a, i);
+        list_remove(&b->free_elem);
+      }
+      for (i = 1; i < d->arena_pages; i++)
+        arena_ofs[vtop(a) / PGSIZE + i] = 0;
+      palloc_free_multiple(a, d->arena_pages);
+      d->arena_cnt--;
+      d->free_cnt -= d->blocks_per_arena;
     }
   }
+  lock_release(&d->lock);
 }
 
 /* Returns the arena that block B is inside. */
 static struct arena* block_to_arena(struct block* b) {
-  struct arena* a = pg_round_down(b);
+  uint8_t* page = pg_round_down(b);
+  struct arena* a = (struct arena*)(page - arena_ofs[vtop(page) / PGSIZE] * PGSIZE);
 
   /* Check that the arena is valid. */
   ASSERT(a != NULL);
   ASSERT(a->magic == ARENA_MAGIC);
 
   /* Check that the block is properly aligned for the arena. */
-  ASSERT(a->desc == NULL || (pg_ofs(b) - sizeof *a) % a->desc->block_size == 0);
+  ASSERT(a->desc == NULL || ((uint8_t*)b - (uint8_t*)(a + 1)) % a->desc->block_size == 0);
   ASSERT(a->desc != NULL || pg_ofs(b) == sizeof *a);
 
   return a;
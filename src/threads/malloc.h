@@ -4,10 +4,23 @@
 #include <debug.h>
 #include <stddef.h>
 
+/* Maximum number of malloc() size classes. */
+#define MALLOC_CLASS_CNT 22
+
+/* A thread's private stack of free blocks for one size class.
+   Kept in struct thread so that most malloc()/free() pairs can
+   be satisfied without taking the size class's lock. */
+struct magazine {
+  struct block* top; /* Most recently cached block. */
+  size_t cnt;        /* Number of cached blocks. */
+};
+
 void malloc_init(void);
 void* malloc(size_t) __attribute__((malloc));
 void* calloc(size_t, size_t) __attribute__((malloc));
 void* realloc(void*, size_t);
 void free(void*);
+void malloc_thread_exit(void);
+void malloc_print_stats(void);
 
 #endif /* threads/malloc.h */
@@ -0,0 +1,204 @@
+#include "threads/memprof.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Kernel heap profiler.
+
+   When enabled with -mprof, every malloc() and every kernel pool
+   palloc request is charged to the address it was called from.
+   Each call site keeps a count and byte total of its live
+   allocations, plus how many allocations it has made in all.
+   To charge a free to the right site, a hash table maps each
+   live allocation's address to its site and size.
+
+   Both tables are fixed in size and allocated once at startup.
+   Allocations that don't fit are only counted as untracked.
+   memprof_print() reports the sites holding the most memory and
+   lists their addresses, which utils/backtrace turns into
+   function names and source lines. */
+
+/* Maximum number of call sites. */
+#define SITE_CNT 512
+
+/* Number of slots in the live allocation table.  Must be a
+   power of 2.  At most 3/4 of the slots are used. */
+#define ALLOC_SLOTS 8192
+
+/* An allocating call site. */
+struct site {
+  void* caller;           /* Return address of the call, or null. */
+  enum memprof_kind kind; /* Allocator called. */
+  size_t live_cnt;        /* Allocations not yet freed. */
+  size_t live_bytes;      /* Bytes in those allocations. */
+  size_t total_cnt;       /* Allocations ever made. */
+};
+
+/* A live allocation. */
+struct alloc {
+  void* ptr;     /* Address, or null for an empty slot. */
+  size_t size;   /* Size in bytes. */
+  uint16_t site; /* Index into SITES. */
+};
+
+bool memprof_enabled;
+
+static struct site* sites;   /* Call sites, hashed by caller. */
+static struct alloc* allocs; /* Live allocations, hashed by ptr. */
+static size_t alloc_cnt;     /* Number of used ALLOCS slots. */
+static size_t untracked_cnt; /* Allocations that didn't fit. */
+
+static size_t alloc_home(const void* ptr);
+static struct site* find_site(void* caller, enum memprof_kind);
+
+/* Allocates the profiler's tables, if profiling is enabled. */
+void memprof_init(void) {
+  if (!memprof_enabled)
+    return;
+  sites = palloc_get_multiple(PAL_ASSERT | PAL_ZERO, DIV_ROUND_UP(SITE_CNT * sizeof *sites, PGSIZE));
+  allocs =
+      palloc_get_multiple(PAL_ASSERT | PAL_ZERO, DIV_ROUND_UP(ALLOC_SLOTS * sizeof *allocs, PGSIZE));
+}
+
+/* Charges the SIZE-byte allocation at PTR, which was requested
+   from CALLER, to CALLER's call site. */
+void memprof_alloc(enum memprof_kind kind, void* ptr, size_t size, void* caller) {
+  enum intr_level old_level;
+  struct site* s;
+  size_t i;
+
+  if (allocs == NULL || ptr == NULL)
+    return;
+
+  old_level = intr_disable();
+  s = find_site(caller, kind);
+  if (s != NULL && alloc_cnt < ALLOC_SLOTS / 4 * 3) {
+    for (i = alloc_home(ptr); allocs[i].ptr != NULL; i = (i + 1) % ALLOC_SLOTS)
+      continue;
+    allocs[i].ptr = ptr;
+    allocs[i].size = size;
+    allocs[i].site = s - sites;
+    alloc_cnt++;
+
+    s->live_cnt++;
+    s->live_bytes += size;
+    s->total_cnt++;
+  } else
+    untracked_cnt++;
+  intr_set_level(old_level);
+}
+
+/* Credits the free of PTR to the call site that allocated it.
+   Does nothing if PTR was not tracked. */
+void memprof_free(void* ptr) {
+  enum intr_level old_level;
+  struct site* s;
+  size_t i, j;
+
+  if (allocs == NULL || ptr == NULL)
+    return;
+
+  old_level = intr_disable();
+  for (i = alloc_home(ptr); allocs[i].ptr != ptr; i = (i + 1) % ALLOC_SLOTS)
+    if (allocs[i].ptr == NULL) {
+      intr_set_level(old_level);
+      return;
+    }
+
+  s = &sites[allocs[i].site];
+  s->live_cnt--;
+  s->live_bytes -= allocs[i].size;
+  alloc_cnt--;
+
+  /* Empty slot I, moving later entries of the same probe run
+     back into it so that lookups never stop short. */
+  for (;;) {
+    allocs[i].ptr = NULL;
+    for (j = (i + 1) % ALLOC_SLOTS;; j = (j + 1) % ALLOC_SLOTS) {
+      size_t home;
+
+      if (allocs[j].ptr == NULL) {
+        intr_set_level(old_level);
+        return;
+      }
+
+      /* Entry J may move to I unless its home lies cyclically
+         in (I, J]. */
+      home = alloc_home(allocs[j].ptr);
+      if (i < j ? home <= i || home > j : home <= i && home > j)
+        break;
+    }
+    allocs[i] = allocs[j];
+    i = j;
+  }
+}
+
+/* Prints the call sites that hold live allocations, most bytes
+   first, then a line of their addresses for utils/backtrace. */
+void memprof_print(void) {
+  static uint16_t order[SITE_CNT];
+  size_t live_bytes = 0;
+  size_t cnt = 0;
+  size_t i, j;
+
+  if (sites == NULL)
+    return;
+
+  /* Sort the sites with live allocations by bytes held. */
+  for (i = 0; i < SITE_CNT; i++) {
+    struct site* s = &sites[i];
+    if (s->caller == NULL || s->live_cnt == 0)
+      continue;
+    for (j = cnt++; j > 0 && sites[order[j - 1]].live_bytes < s->live_bytes; j--)
+      order[j] = order[j - 1];
+    order[j] = i;
+    live_bytes += s->live_bytes;
+  }
+
+  printf("Heap profile: %zu live allocations, %zu bytes, from %zu sites", alloc_cnt, live_bytes,
+         cnt);
+  if (untracked_cnt > 0)
+    printf(" (%zu allocations untracked)", untracked_cnt);
+  printf("\n");
+  for (i = 0; i < cnt; i++) {
+    struct site* s = &sites[order[i]];
+    printf("  %p %s: %zu live, %zu bytes, %zu total\n", s->caller,
+           s->kind == MEMPROF_MALLOC ? "malloc" : "palloc", s->live_cnt, s->live_bytes,
+           s->total_cnt);
+  }
+
+  printf("Allocation sites:");
+  for (i = 0; i < cnt; i++)
+    printf(" %p", sites[order[i]].caller);
+  printf(".\n");
+  printf("Pass the allocation sites to `backtrace' to see where they are.\n");
+}
+
+/* Returns the BLOCKS slot where a search for PTR begins. */
+static size_t alloc_home(const void* ptr) {
+  return ((uintptr_t)ptr >> 4) * 2654435761u % ALLOC_SLOTS;
+}
+
+/* Returns the site for allocations of KIND from CALLER, adding
+   it if it is new.  Returns a null pointer if SITES is full. */
+static struct site* find_site(void* caller, enum memprof_kind kind) {
+  size_t start = (uintptr_t)caller * 2654435761u % SITE_CNT;
+  size_t i = start;
+
+  do {
+    struct site* s = &sites[i];
+    if (s->caller == caller)
+      return s;
+    if (s->caller == NULL) {
+      s->caller = caller;
+      s->kind = kind;
+      return s;
+    }
+    i = (i + 1) % SITE_CNT;
+  } while (i != start);
+  return NULL;
+}
@@ -0,0 +1,21 @@
+#ifndef THREADS_MEMPROF_H
+#define THREADS_MEMPROF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Allocators that report to the profiler. */
+enum memprof_kind {
+  MEMPROF_MALLOC, /* malloc(), calloc(), realloc(). */
+  MEMPROF_PALLOC  /* Kernel pool pages from palloc. */
+};
+
+/* -mprof: Track kernel allocations by call site? */
+extern bool memprof_enabled;
+
+void memprof_init(void);
+void memprof_alloc(enum memprof_kind, void* ptr, size_t size, void* caller);
+void memprof_free(void* ptr);
+void memprof_print(void);
+
+#endif /* threads/memprof.h */
@@ -2,13 +2,15 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/memprof.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,20 +25,59 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Within a pool, free pages are kept by a binary buddy
+   allocator.  Free memory is a set of blocks of 2**ORDER pages,
+   each aligned to its size relative to the pool base, kept on a
+   free list per order.  A request takes the smallest block that
+   is large enough, splitting larger blocks as needed, and gives
+   back the pages it doesn't use.  Freed blocks merge with their
+   buddies.  Both take O(log n) list operations instead of a scan
+   of the whole pool.
+
+   A pool's free lists and bitmap are updated with interrupts
+   disabled rather than under a lock, because thread_switch_tail()
+   frees a dying thread's page with interrupts already off and so
+   cannot sleep on a lock.  Every critical section is short. */
+
+/* Each pool also keeps a stash of up to ZEROED_MAX free pages
+   that the idle thread has already zeroed, so that single-page
+   PAL_ZERO requests don't memset() a page on the caller's time.
+   The idle thread zeroes at most ZEROED_BATCH pages per pool
+   each time it runs. */
+#define ZEROED_MAX 32
+#define ZEROED_BATCH 4
+
+/* Number of block orders.  The largest block is
+   2**(BUDDY_ORDERS - 1) pages. */
+#define BUDDY_ORDERS 16
 
 /* A memory pool. */
 struct pool {
-  struct lock lock;        /* Mutual exclusion. */
   struct bitmap* used_map; /* Bitmap of free pages. */
   uint8_t* base;           /* Base of pool. */
+
+  /* Buddy allocator. */
+  struct list free_lists[BUDDY_ORDERS]; /* Free blocks of each order. */
+  uint8_t* free_order; /* Per page: 1 + order if it heads a free block, else 0. */
+
+  /* Pre-zeroed pages.  Each holds its list element in its first
+     bytes, which are cleared when it is handed out. */
+  struct list zeroed; /* Zeroed pages, allocated in used_map. */
+  size_t zeroed_cnt;  /* Number of pages in zeroed. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
 static void init_pool(struct pool*, void* base, size_t page_cnt, const char* name);
+static void* get_pages(enum palloc_flags, size_t page_cnt);
 static bool page_from_pool(const struct pool*, void* page);
+static size_t buddy_alloc(struct pool*, size_t page_cnt);
+static void buddy_free_range(struct pool*, size_t page_idx, size_t page_cnt);
+static void drain_zeroed(struct pool*);
+static void refill_zeroed(struct pool*);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -63,16 +104,40 @@ void palloc_init(size_t user_page_limit) {
    available, returns a null pointer, unless PAL_ASSERT is set in
    FLAGS, in which case the kernel panics. */
 void* palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
+  void* pages = get_pages(flags, page_cnt);
+  if (!(flags & PAL_USER))
+    memprof_alloc(MEMPROF_PALLOC, pages, page_cnt * PGSIZE, __builtin_return_address(0));
+  return pages;
+}
+
+/* Does the work of palloc_get_multiple(), without profiling. */
+static void* get_pages(enum palloc_flags flags, size_t page_cnt) {
   struct pool* pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
   void* pages;
   size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire(&pool->lock);
-  page_idx = bitmap_scan_and_flip(pool->used_map, 0, page_cnt, false);
-  lock_release(&pool->lock);
+  old_level = intr_disable();
+  if (page_cnt == 1 && (flags & PAL_ZERO) && !list_empty(&pool->zeroed)) {
+    /* Hand out a page the idle thread zeroed. */
+    pages = list_pop_front(&pool->zeroed);
+    pool->zeroed_cnt--;
+    intr_set_level(old_level);
+    memset(pages, 0, sizeof(struct list_elem));
+    return pages;
+  }
+  page_idx = buddy_alloc(pool, page_cnt);
+  if (page_idx == BITMAP_ERROR && pool->zeroed_cnt > 0) {
+    /* Memory is short, so give the stash back and retry. */
+    drain_zeroed(pool);
+    page_idx = buddy_alloc(pool, page_cnt);
+  }
+  if (page_idx != BITMAP_ERROR)
+    bitmap_set_multiple(pool->used_map, page_idx, page_cnt, true);
+  intr_set_level(old_level);
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -97,16 +162,23 @@ void* palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
    then the page is filled with zeros.  If no pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
    FLAGS, in which case the kernel panics. */
-void* palloc_get_page(enum palloc_flags flags) { return palloc_get_multiple(flags, 1); }
+void* palloc_get_page(enum palloc_flags flags) {
+  void* page = get_pages(flags, 1);
+  if (!(flags & PAL_USER))
+    memprof_alloc(MEMPROF_PALLOC, page, PGSIZE, __builtin_return_address(0));
+  return page;
+}
 
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void palloc_free_multiple(void* pages, size_t page_cnt) {
   struct pool* pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT(pg_ofs(pages) == 0);
   if (pages == NULL || page_cnt == 0)
     return;
+  memprof_free(pages);
 
   if (page_from_pool(&kernel_pool, pages))
     pool = &kernel_pool;
@@ -121,20 +193,34 @@ void palloc_free_multiple(void* pages, size_t page_cnt) {
   memset(pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable();
   ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+  buddy_free_range(pool, page_idx, page_cnt);
+  intr_set_level(old_level);
 }
 
 /* Frees the page at PAGE. */
 void palloc_free_page(void* page) { palloc_free_multiple(page, 1); }
 
+/* Zeroes a few free pages into each pool's stash of pre-zeroed
+   pages.  Called by the idle thread, which must never block, so
+   the stash is updated with interrupts disabled rather than under
+   a lock.  If the idle thread is preempted while zeroing a page,
+   it simply finishes the page the next time it runs. */
+void palloc_zero_idle(void) {
+  refill_zeroed(&kernel_pool);
+  refill_zeroed(&user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void init_pool(struct pool* p, void* base, size_t page_cnt, const char* name) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP(bitmap_buf_size(page_cnt), PGSIZE);
+  /* We'll put the pool's used_map and the buddy allocator's
+     per-page orders at its base.  Calculate the space needed for
+     them and subtract it from the pool's size. */
+  size_t bm_size = bitmap_buf_size(page_cnt);
+  size_t bm_pages = DIV_ROUND_UP(bm_size + page_cnt, PGSIZE);
   if (bm_pages > page_cnt)
     PANIC("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -142,9 +228,87 @@ static void init_pool(struct pool* p, void* base, size_t page_cnt, const char* n
   printf("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init(&p->lock);
-  p->used_map = bitmap_create_in_buf(page_cnt, base, bm_pages * PGSIZE);
+  p->used_map = bitmap_create_in_buf(page_cnt, base, bm_size);
   p->base = base + bm_pages * PGSIZE;
+
+  /* Hand all of the pool's pages to the buddy allocator. */
+  p->free_order = (uint8_t*)base + bm_size;
+  memset(p->free_order, 0, page_cnt);
+  for (int order = 0; order < BUDDY_ORDERS; order++)
+    list_init(&p->free_lists[order]);
+  buddy_free_range(p, 0, page_cnt);
+
+  list_init(&p->zeroed);
+  p->zeroed_cnt = 0;
+}
+
+/* Returns the free list element stored in page PAGE_IDX of POOL,
+   which must be free. */
+static struct list_elem* page_elem(struct pool* pool, size_t page_idx) {
+  return (struct list_elem*)(pool->base + PGSIZE * page_idx);
+}
+
+/* Returns the index within POOL of the page holding free list
+   element E. */
+static size_t elem_page(struct pool* pool, struct list_elem* e) {
+  return pg_no(e) - pg_no(pool->base);
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX in POOL, merging
+   it with its buddy, and the merged block with its buddy, for as
+   long as the buddy is free. */
+static void buddy_free(struct pool* pool, size_t page_idx, int order) {
+  while (order < BUDDY_ORDERS - 1) {
+    size_t buddy = page_idx ^ ((size_t)1 << order);
+    if (buddy >= bitmap_size(pool->used_map) || pool->free_order[buddy] != order + 1)
+      break;
+    list_remove(page_elem(pool, buddy));
+    pool->free_order[buddy] = 0;
+    page_idx &= ~((size_t)1 << order);
+    order++;
+  }
+  pool->free_order[page_idx] = order + 1;
+  list_push_front(&pool->free_lists[order], page_elem(pool, page_idx));
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL, as the largest
+   aligned blocks they divide into. */
+static void buddy_free_range(struct pool* pool, size_t page_idx, size_t page_cnt) {
+  while (page_cnt > 0) {
+    int order = 0;
+    while (order < BUDDY_ORDERS - 1 && (page_idx & (((size_t)2 << order) - 1)) == 0 &&
+           ((size_t)2 << order) <= page_cnt)
+      order++;
+    buddy_free(pool, page_idx, order);
+    page_idx += (size_t)1 << order;
+    page_cnt -= (size_t)1 << order;
+  }
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no free block is large
+   enough.  Takes the smallest block of at least PAGE_CNT pages,
+   splitting larger ones, and frees the pages past PAGE_CNT. */
+static size_t buddy_alloc(struct pool* pool, size_t page_cnt) {
+  int order = 0, avail;
+
+  while (order < BUDDY_ORDERS && ((size_t)1 << order) < page_cnt)
+    order++;
+  for (avail = order; avail < BUDDY_ORDERS; avail++)
+    if (!list_empty(&pool->free_lists[avail]))
+      break;
+  if (avail >= BUDDY_ORDERS)
+    return BITMAP_ERROR;
+
+  size_t page_idx = elem_page(pool, list_pop_front(&pool->free_lists[avail]));
+  pool->free_order[page_idx] = 0;
+  while (avail > order) {
+    avail--;
+    pool->free_order[page_idx + ((size_t)1 << avail)] = avail + 1;
+    list_push_front(&pool->free_lists[avail], page_elem(pool, page_idx + ((size_t)1 << avail)));
+  }
+  buddy_free_range(pool, page_idx + page_cnt, ((size_t)1 << order) - page_cnt);
+  return page_idx;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -156,3 +320,44 @@ static bool page_from_pool(const struct pool* pool, void* page) {
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns every page in POOL's stash of zeroed pages to the buddy
+   allocator.  Interrupts must be off. */
+static void drain_zeroed(struct pool* pool) {
+  while (!list_empty(&pool->zeroed)) {
+    size_t page_idx = elem_page(pool, list_pop_front(&pool->zeroed));
+    bitmap_reset(pool->used_map, page_idx);
+    buddy_free_range(pool, page_idx, 1);
+  }
+  pool->zeroed_cnt = 0;
+}
+
+/* Zeroes up to ZEROED_BATCH free pages of POOL into its stash,
+   stopping when the stash is full or the pool is out of pages.
+   The page is zeroed with interrupts on. */
+static void refill_zeroed(struct pool* pool) {
+  enum intr_level old_level;
+
+  for (int n = 0; n < ZEROED_BATCH; n++) {
+    size_t page_idx = BITMAP_ERROR;
+    void* page;
+
+    old_level = intr_disable();
+    if (pool->zeroed_cnt < ZEROED_MAX) {
+      page_idx = buddy_alloc(pool, 1);
+      if (page_idx != BITMAP_ERROR)
+        bitmap_mark(pool->used_map, page_idx);
+    }
+    intr_set_level(old_level);
+    if (page_idx == BITMAP_ERROR)
+      return;
+
+    page = pool->base + PGSIZE * page_idx;
+    memset(page, 0, PGSIZE);
+
+    old_level = intr_disable();
+    list_push_front(&pool->zeroed, page);
+    pool->zeroed_cnt++;
+    intr_set_level(old_level);
+  }
+}
@@ -0,0 +1,196 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator.
+
+   Each cache hands out objects of a single size.  It obtains
+   whole pages, called "slabs", from the page allocator and
+   divides each one into as many objects as fit after the slab
+   header.  Objects are therefore packed at their exact size
+   instead of being rounded up to a power of 2 as malloc() does,
+   and objects of one type share pages with each other.
+
+   A slab's free objects form a singly linked list threaded
+   through their first word.  Slabs that have a free object sit
+   on the cache's partial list; full slabs are on no list and
+   are found again from an object's address when it is freed.
+   When a slab becomes completely free it is given back to the
+   page allocator, except that each cache keeps one such slab in
+   reserve so that an allocation that follows a free does not
+   have to go to the page allocator. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x5ab5ab00
+
+/* Slab header, at the start of each slab's page. */
+struct slab {
+  unsigned magic;           /* Always set to SLAB_MAGIC. */
+  struct slab_cache* cache; /* Owning cache. */
+  struct list_elem elem;    /* Element in cache's partial list. */
+  size_t free_cnt;          /* Number of free objects. */
+  void* free;               /* First free object. */
+};
+
+/* All caches, for slab_print_stats(). */
+static struct list caches;
+static struct lock caches_lock;
+
+static struct slab* obj_to_slab(struct slab_cache*, void*);
+
+/* Initializes the slab allocator. */
+void slab_init(void) {
+  list_init(&caches);
+  lock_init(&caches_lock);
+}
+
+/* Creates and returns a cache for objects of SIZE bytes, called
+   NAME.  If CTOR is nonnull, slab_alloc() calls it on each
+   object before returning it.  Panics if memory is not
+   available, since caches are created at initialization. */
+struct slab_cache* slab_cache_create(const char* name, size_t size, slab_ctor_func* ctor) {
+  struct slab_cache* c;
+
+  ASSERT(name != NULL);
+  ASSERT(size > 0);
+
+  size = ROUND_UP(size, sizeof(void*));
+  ASSERT(size <= PGSIZE - sizeof(struct slab));
+
+  c = malloc(sizeof *c);
+  if (c == NULL)
+    PANIC("no memory for slab cache %s", name);
+
+  c->name = name;
+  c->obj_size = size;
+  c->objs_per_slab = (PGSIZE - sizeof(struct slab)) / size;
+  c->ctor = ctor;
+  list_init(&c->partial);
+  c->spare = NULL;
+  lock_init(&c->lock);
+  c->slab_cnt = c->live_cnt = c->peak_cnt = c->alloc_cnt = 0;
+
+  lock_acquire(&caches_lock);
+  list_push_back(&caches, &c->elem);
+  lock_release(&caches_lock);
+  return c;
+}
+
+/* Obtains and returns a new object from cache C.
+   Returns a null pointer if memory is not available. */
+void* slab_alloc(struct slab_cache* c) {
+  struct slab* s;
+  void* obj;
+
+  lock_acquire(&c->lock);
+
+  /* If no slab has a free object, create a new slab. */
+  if (list_empty(&c->partial)) {
+    uint8_t* p;
+    size_t i;
+
+    s = palloc_get_page(0);
+    if (s == NULL) {
+      lock_release(&c->lock);
+      return NULL;
+    }
+
+    /* Initialize slab and link its objects onto its free list. */
+    s->magic = SLAB_MAGIC;
+    s->cache = c;
+    s->free_cnt = c->objs_per_slab;
+    s->free = NULL;
+    p = (uint8_t*)(s + 1) + c->objs_per_slab * c->obj_size;
+    for (i = 0; i < c->objs_per_slab; i++) {
+      p -= c->obj_size;
+      *(void**)p = s->free;
+      s->free = p;
+    }
+    list_push_back(&c->partial, &s->elem);
+    c->slab_cnt++;
+  }
+
+  /* Take an object from the first slab with one free. */
+  s = list_entry(list_front(&c->partial), struct slab, elem);
+  obj = s->free;
+  s->free = *(void**)obj;
+  if (--s->free_cnt == 0)
+    list_remove(&s->elem);
+  if (s == c->spare)
+    c->spare = NULL;
+
+  c->alloc_cnt++;
+  if (++c->live_cnt > c->peak_cnt)
+    c->peak_cnt = c->live_cnt;
+  lock_release(&c->lock);
+
+  if (c->ctor != NULL)
+    c->ctor(obj);
+  return obj;
+}
+
+/* Returns OBJ, which must have been obtained from cache C with
+   slab_alloc(), to C.  A null OBJ is ignored. */
+void slab_free(struct slab_cache* c, void* obj) {
+  struct slab* s;
+
+  if (obj == NULL)
+    return;
+  s = obj_to_slab(c, obj);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs. */
+  memset(obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire(&c->lock);
+  *(void**)obj = s->free;
+  s->free = obj;
+  if (s->free_cnt++ == 0)
+    list_push_front(&c->partial, &s->elem);
+  c->live_cnt--;
+
+  /* Give a completely free slab back to the page allocator,
+     unless we have no spare yet. */
+  if (s->free_cnt == c->objs_per_slab) {
+    if (c->spare == NULL)
+      c->spare = s;
+    else if (c->spare != s) {
+      list_remove(&s->elem);
+      c->slab_cnt--;
+      palloc_free_page(s);
+    }
+  }
+  lock_release(&c->lock);
+}
+
+/* Prints statistics for each slab cache. */
+void slab_print_stats(void) {
+  struct list_elem* e;
+
+  for (e = list_begin(&caches); e != list_end(&caches); e = list_next(e)) {
+    struct slab_cache* c = list_entry(e, struct slab_cache, elem);
+    printf("Slab %s: %zu-byte objects, %zu slabs, %zu live (peak %zu), %zu allocations\n",
+           c->name, c->obj_size, c->slab_cnt, c->live_cnt, c->peak_cnt, c->alloc_cnt);
+  }
+}
+
+/* Returns the slab of cache C that object OBJ is inside. */
+static struct slab* obj_to_slab(struct slab_cache* c, void* obj) {
+  struct slab* s = pg_round_down(obj);
+
+  /* Check that the slab is valid and belongs to C. */
+  ASSERT(s->magic == SLAB_MAGIC);
+  ASSERT(s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT((pg_ofs(obj) - sizeof *s) % c->obj_size == 0);
+
+  return s;
+}
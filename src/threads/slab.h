@@ -0,0 +1,34 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Initializes a newly allocated object. */
+typedef void slab_ctor_func(void* obj);
+
+/* A cache of fixed-size objects of one type, carved out of
+   whole pages obtained from the page allocator. */
+struct slab_cache {
+  const char* name;      /* Name, for statistics. */
+  size_t obj_size;       /* Size of each object in bytes. */
+  size_t objs_per_slab;  /* Number of objects in a slab. */
+  slab_ctor_func* ctor;  /* Constructor, or a null pointer. */
+  struct list partial;   /* Slabs with at least one free object. */
+  struct slab* spare;    /* Completely free slab kept for reuse. */
+  struct lock lock;      /* Protects the members above and below. */
+  size_t slab_cnt;       /* Number of slabs. */
+  size_t live_cnt;       /* Objects currently allocated. */
+  size_t peak_cnt;       /* Largest LIVE_CNT seen. */
+  size_t alloc_cnt;      /* Total calls to slab_alloc(). */
+  struct list_elem elem; /* Element in list of all caches. */
+};
+
+void slab_init(void);
+struct slab_cache* slab_cache_create(const char* name, size_t size, slab_ctor_func*);
+void* slab_alloc(struct slab_cache*) __attribute__((malloc));
+void slab_free(struct slab_cache*, void*);
+void slab_print_stats(void);
+
+#endif /* threads/slab.h */
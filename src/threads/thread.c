@@ -299,6 +299,9 @@ tid_t thread_tid(void) { return thread_current()->tid; }
 void thread_exit(void) {
   ASSERT(!intr_context());
 
+  /* Hand cached malloc() blocks back before our page goes away. */
+  malloc_thread_exit();
+
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_switch_tail(). */
@@ -381,6 +384,9 @@ static void idle(void* idle_started_ UNUSED) {
   sema_up(idle_started);
 
   for (;;) {
+    /* Use the idle time to zero pages for PAL_ZERO requests. */
+    palloc_zero_idle();
+
     /* Let someone else run. */
     intr_disable();
     thread_block();
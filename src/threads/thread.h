@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include "threads/synch.h"
 #include "threads/fixed-point.h"
+#include "threads/malloc.h"
 
 /* States in a thread's life cycle. */
 enum thread_status {
@@ -97,6 +98,13 @@ struct thread {
   /* Owned by process.c. */
   struct process* pcb; /* Process control block if this thread is a userprog */
 #endif
+#ifdef VM
+  /* Owned by userprog/syscall.c. */
+  void* user_esp; /* User stack pointer at entry to the current system call. */
+#endif
+
+  /* Owned by malloc.c. */
+  struct magazine magazines[MALLOC_CLASS_CNT]; /* Cached free blocks. */
 
   /* Owned by thread.c. */
   unsigned magic; /* Detects stack overflow. */
@@ -5,6 +5,9 @@
 #include "userprog/process.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -135,9 +138,18 @@ static void page_fault(struct intr_frame* f) {
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
-  /* To implement virtual memory, delete the rest of the function
-     body, and replace it with code that brings in the page to
-     which fault_addr refers. */
+#ifdef VM
+  /* A user page that hasn't been loaded yet, or the stack
+     growing.  This can also happen in the kernel, when a system
+     call touches user memory, in which case the stack pointer is
+     the one saved at entry to the system call. */
+  if (not_present) {
+    void* esp = user ? f->esp : thread_current()->user_esp;
+    if (page_load(fault_addr) || (page_grow_stack(fault_addr, esp) && page_load(fault_addr)))
+      return;
+  }
+#endif
+
   printf("Page fault at %p: %s error %s page in %s context.\n", fault_addr,
          not_present ? "not present" : "rights violation", write ? "writing" : "reading",
          user ? "user" : "kernel");
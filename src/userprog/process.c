@@ -16,10 +16,20 @@
 #include "threads/interrupt.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/syscall.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
+
+/* Caches for per-process bookkeeping. */
+static struct slab_cache* process_cache;
+static struct slab_cache* wait_status_cache;
+struct slab_cache* file_dir_cache;
 
 static thread_func start_process NO_RETURN;
 static bool load(const char* file_name, void (**eip)(void), void** esp);
@@ -30,14 +40,22 @@ static bool load(const char* file_name, void (**eip)(void), void** esp);
    initialized here if main needs those members */
 void userprog_init(void) {
   struct thread* t = thread_current();
+  struct process* pcb;
   bool success;
 
+  process_cache = slab_cache_create("process", sizeof(struct process), NULL);
+  wait_status_cache = slab_cache_create("wait_status", sizeof(struct wait_status), NULL);
+  file_dir_cache = slab_cache_create("file_dir", sizeof(struct file_dir), NULL);
+
   /* Allocate process control block
-     It is imoprtant that this is a call to calloc and not malloc,
+     It is imoprtant that the PCB is zeroed before it is assigned,
      so that t->pcb->pagedir is guaranteed to be NULL (the kernel's
      page directory) when t->pcb is assigned, because a timer interrupt
      can come at any time and activate our pagedir */
-  t->pcb = calloc(sizeof(struct process), 1);
+  pcb = slab_alloc(process_cache);
+  if (pcb != NULL)
+    memset(pcb, 0, sizeof *pcb);
+  t->pcb = pcb;
   success = t->pcb != NULL;
 
   /* Initialize list of children */
@@ -109,7 +127,7 @@ static void start_process(void* file_name_) {
   bool success, pcb_success;
 
   /* Allocate process control block */
-  struct process* new_pcb = malloc(sizeof(struct process));
+  struct process* new_pcb = slab_alloc(process_cache);
 
   /* Initialize children list for current thread */
   list_init(&new_pcb->children);
@@ -123,6 +141,19 @@ static void start_process(void* file_name_) {
   /* Initialize FDT for this new PCB */
   list_init(&new_pcb->fdt);
 
+#ifdef VM
+  /* Initialize the supplemental page table and memory mappings */
+  if (success && !page_table_init(&new_pcb->pages)) {
+    slab_free(process_cache, new_pcb);
+    new_pcb = NULL;
+    success = pcb_success = false;
+  }
+  if (success) {
+    list_init(&new_pcb->mappings);
+    new_pcb->next_mapid = 0;
+  }
+#endif
+
   /* Parse string arguments seperated by spaces */
   char file_copy[strlen(file_name) + 1];
   strlcpy(file_copy, file_name, strlen(file_name) + 1);
@@ -182,7 +213,10 @@ static void start_process(void* file_name_) {
       // can try to activate the pagedir, but it is now freed memory
       struct process* pcb_to_free = t->pcb;
       t->pcb = NULL;
-      free(pcb_to_free);
+#ifdef VM
+      page_table_destroy(&pcb_to_free->pages);
+#endif
+      slab_free(process_cache, pcb_to_free);
     }
 
     if (!success) {
@@ -253,7 +287,7 @@ static void start_process(void* file_name_) {
     /* Initialize shared data struct for this process and its parent
        contingent upon successful load. */
     load_data->loaded = true;
-    t->pcb->wait_status = malloc(sizeof(struct wait_status));
+    t->pcb->wait_status = slab_alloc(wait_status_cache);
 
     // put wait_status struct into load_data so parent has access to it
     load_data->wait_status = t->pcb->wait_status;
@@ -317,7 +351,7 @@ int process_wait(pid_t child_pid) {
      the child process is guaranteed to have finished at this point). */
   int exit_code = child->exit_code;
   list_remove(&child->elem);
-  free(child);
+  slab_free(wait_status_cache, child);
 
   return exit_code;
 }
@@ -334,23 +368,15 @@ void process_exit(void) {
     NOT_REACHED();
   }
 
-  /* Close all files in the file descriptor table */
-  while (!list_empty(&pcb->fdt)) {
-    struct file_dir* file_dir = list_entry(list_pop_front(&pcb->fdt), struct file_dir, elem);
-    struct file* tmp = file_dir->file;
-    file_close(tmp);
-    free(file_dir);
-  }
-
-  /* Close current running executable */
-  file_close(pcb->running_file);
-  pcb->running_file = NULL;
-
-  /* Close CWD */
-  dir_close(pcb->cwd);
+#ifdef VM
+  /* Write back and unmap memory-mapped files */
+  mmap_unmap_all();
+#endif
 
   /* Destroy the current process's page directory and switch back
-     to the kernel-only page directory. */
+     to the kernel-only page directory.  This comes before the
+     executable is closed below, because the page table still
+     refers to it. */
   pd = cur->pcb->pagedir;
   if (pd != NULL) {
     /* Correct ordering here is crucial.  We must set
@@ -362,9 +388,27 @@ void process_exit(void) {
          that's been freed (and cleared). */
     cur->pcb->pagedir = NULL;
     pagedir_activate(NULL);
+#ifdef VM
+    page_table_destroy(&pcb->pages);
+#endif
     pagedir_destroy(pd);
   }
 
+  /* Close all files in the file descriptor table */
+  while (!list_empty(&pcb->fdt)) {
+    struct file_dir* file_dir = list_entry(list_pop_front(&pcb->fdt), struct file_dir, elem);
+    struct file* tmp = file_dir->file;
+    file_close(tmp);
+    slab_free(file_dir_cache, file_dir);
+  }
+
+  /* Close current running executable */
+  file_close(pcb->running_file);
+  pcb->running_file = NULL;
+
+  /* Close CWD */
+  dir_close(pcb->cwd);
+
   printf("%s: exit(%d)\n", pcb->process_name, pcb->wait_status->exit_code);
 
   /* Up the wait_status's semaphore before exiting this process. */
@@ -377,7 +421,7 @@ void process_exit(void) {
   lock_release(&pcb->wait_status->refs_lock);
   if (pcb->wait_status->refs_count == 0) {
     list_remove(&pcb->wait_status->elem);
-    free(pcb->wait_status);
+    slab_free(wait_status_cache, pcb->wait_status);
   }
 
   /* Decrement ref_counts of all children processes, freeing/removing
@@ -391,7 +435,7 @@ void process_exit(void) {
     lock_release(&child->refs_lock);
     if (child->refs_count == 0) {
       list_remove(&child->elem);
-      free(child);
+      slab_free(wait_status_cache, child);
     }
   }
 
@@ -401,7 +445,7 @@ void process_exit(void) {
     can try to activate the pagedir, but it is now freed memory */
   struct process* pcb_to_free = cur->pcb;
   cur->pcb = NULL;
-  free(pcb_to_free);
+  slab_free(process_cache, pcb_to_free);
 
   thread_exit();
 }
@@ -592,7 +636,9 @@ done:
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page(void* upage, void* kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -661,6 +707,13 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
     size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
     size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+    /* Just record where the page comes from; it is read in
+       when the process first touches it. */
+    if (!page_add(upage, page_read_bytes > 0 ? file : NULL, ofs, page_read_bytes, writable))
+      return false;
+    ofs += page_read_bytes;
+#else
     /* Get a page of memory. */
     uint8_t* kpage = palloc_get_page(PAL_USER);
     if (kpage == NULL)
@@ -678,6 +731,7 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
       palloc_free_page(kpage);
       return false;
     }
+#endif
 
     /* Advance. */
     read_bytes -= page_read_bytes;
@@ -690,10 +744,17 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
 /* Create a minimal stack by mapping a zeroed page at the top of
    user virtual memory. */
 static bool setup_stack(void** esp) {
-  uint8_t* kpage;
   bool success = false;
 
-  kpage = palloc_get_page(PAL_USER | PAL_ZERO);
+#ifdef VM
+  /* The stack page is a zero page like any other, but load it
+     now since start_process() pushes the arguments onto it. */
+  uint8_t* upage = ((uint8_t*)PHYS_BASE) - PGSIZE;
+  success = page_add(upage, NULL, 0, 0, true) && page_load(upage);
+  if (success)
+    *esp = PHYS_BASE;
+#else
+  uint8_t* kpage = palloc_get_page(PAL_USER | PAL_ZERO);
   if (kpage != NULL) {
     success = install_page(((uint8_t*)PHYS_BASE) - PGSIZE, kpage, true);
     if (success)
@@ -701,9 +762,11 @@ static bool setup_stack(void** esp) {
     else
       palloc_free_page(kpage);
   }
+#endif
   return success;
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -721,6 +784,7 @@ static bool install_page(void* upage, void* kpage, bool writable) {
   return (pagedir_get_page(t->pcb->pagedir, upage) == NULL &&
           pagedir_set_page(t->pcb->pagedir, upage, kpage, writable));
 }
+#endif
 
 /* Returns true if t is the main thread of the process p */
 bool is_main_thread(struct thread* t, struct process* p) { return p->main_thread == t; }
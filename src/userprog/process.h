@@ -4,6 +4,10 @@
 #include "threads/thread.h"
 #include <stdint.h>
 #include "filesys/file.h"
+#include "threads/slab.h"
+#ifdef VM
+#include <hash.h>
+#endif
 
 // At most 8MB can be allocated to the stack
 // These defines will be used in Project 2: Multithreading
@@ -38,6 +42,15 @@ struct process {
   // project 3 additions
   struct dir* cwd;    /* ADDED: Current working directory */
   bool first_process; /* ADDED: Indicates whether or not cwd should be the root dir */
+
+#ifdef VM
+  /* Owned by vm/page.c. */
+  struct hash pages; /* Supplemental page table. */
+
+  /* Owned by vm/mmap.c. */
+  struct list mappings; /* Memory-mapped files. */
+  int next_mapid;       /* Identifier for the next mapping. */
+#endif
 };
 
 /* Shared data struct between parent and child so that parent can wait on child thread. */
@@ -69,6 +82,9 @@ struct file_dir {
   struct list_elem elem; /* ADDED: List elem for FDT */
 };
 
+/* Cache that file descriptor table entries are allocated from. */
+extern struct slab_cache* file_dir_cache;
+
 void userprog_init(void);
 
 pid_t process_execute(const char* file_name);
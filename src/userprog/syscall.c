@@ -1,5 +1,6 @@
 /* Includes pagedir.c */
 #include "userprog/syscall.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
@@ -18,11 +19,16 @@
 #include <float.h>
 
 #include "filesys/directory.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
 
 struct lock syscall_lock;
 
 /* Prototype functions */
 static void syscall_handler(struct intr_frame*);
+static void syscall_dispatch(struct intr_frame*, uint32_t* args);
 void syscall_init(void) {
   lock_init(&syscall_lock);
   intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
@@ -35,11 +41,41 @@ void validate_pointer(void* ptr, size_t size);
 void validate_string(char* string);
 
 /* Main syscall handler */
-static void syscall_handler(struct intr_frame* f UNUSED) {
+static void syscall_handler(struct intr_frame* f) {
   uint32_t* args = ((uint32_t*)f->esp);
 
+#ifdef VM
+  /* Save the user stack pointer, so page faults in the kernel
+     can tell whether the stack needs to grow */
+  thread_current()->user_esp = f->esp;
+#endif
+
   validate_pointer(args, sizeof(uint32_t));
   validate_pointer(&args[1], sizeof(args[1]));
+
+#ifdef VM
+  /* Pin read and write buffers in memory for the whole call, since
+     the file system can't take page faults on them while holding
+     its locks */
+  if (args[0] == SYS_READ || args[0] == SYS_WRITE) {
+    validate_pointer(&args[3], sizeof(args[3]));
+    void* buffer = (void*)args[2];
+    size_t size = (size_t)args[3];
+    if (!page_pin_range(buffer, size, args[0] == SYS_READ)) {
+      thread_current()->pcb->wait_status->exit_code = -1;
+      return process_exit();
+    }
+    syscall_dispatch(f, args);
+    page_unpin_range(buffer, size);
+    return;
+  }
+#endif
+
+  syscall_dispatch(f, args);
+}
+
+/* Carries out the system call whose number and arguments are ARGS */
+static void syscall_dispatch(struct intr_frame* f, uint32_t* args) {
   /*
    * The following print statement, if uncommented, will print out the syscall
    * number whenever a process enters a system call. You might find it useful
@@ -100,6 +136,7 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
         file_close(open_file_table);
       }
       list_remove(&open_file_wrapper->elem);
+      slab_free(file_dir_cache, open_file_wrapper);
     }
     lock_release(&syscall_lock);
   }
@@ -137,7 +174,7 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
   }
 
   /* Open -- syscall */
-  if (args[0] == SYS_OPEN) {
+  if (args[0] == SYS_OPEN || args[0] == SYS_OPEN_APPEND) {
     lock_acquire(&syscall_lock);
     char* file_name = (char*)args[1];
     struct process* pcb = thread_current()->pcb;
@@ -167,7 +204,7 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
     }
 
     // initialize fd wrapper for file
-    struct file_dir* file_dir = malloc(sizeof(struct file_dir));
+    struct file_dir* file_dir = slab_alloc(file_dir_cache);
     file_dir->file = open_file;
     file_dir->dir = open_dir;
     // need to change this to accommodate for absolute and relative paths
@@ -177,6 +214,7 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
       file_dir->isdir = true;
     } else {
       file_dir->isdir = false;
+      file_set_append(open_file, args[0] == SYS_OPEN_APPEND);
     }
 
     /* Else, add open_file to FDT */
@@ -288,7 +326,33 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
       return;
     }
     struct file* file_name = file_wrapper->file;
-    if (file_name) {
+    if (file_name && file_name->append) {
+      /* Appends reserve their range in the inode, so they don't
+         need syscall_lock to run alongside other appenders.  Write
+         through a private reopening of the file, so that closing FD
+         meanwhile can't free it under us, then move FD's position
+         up to the end of the write if FD is still open.  FDs are
+         never reused, so an FD found again is the same file. */
+      struct file* writer = file_reopen(file_name);
+      if (writer == NULL) {
+        f->eax = -1;
+        lock_release(&syscall_lock);
+        return;
+      }
+      file_set_append(writer, true);
+      lock_release(&syscall_lock);
+      off_t bytes_written = file_write(writer, buffer, size);
+
+      lock_acquire(&syscall_lock);
+      file_wrapper = get_file_wrapper(args);
+      if (file_wrapper != NULL && file_wrapper->file == file_name &&
+          file_tell(writer) > file_tell(file_name))
+        file_seek(file_name, file_tell(writer));
+      file_close(writer);
+      lock_release(&syscall_lock);
+      f->eax = bytes_written;
+      return;
+    } else if (file_name) {
       off_t bytes_read = 0;
       off_t total = 0;
       while ((bytes_read = file_write(file_name, buffer, size - total))) {
@@ -383,6 +447,149 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
 
     lock_release(&syscall_lock);
   }
+
+  /* getdents syscall */
+  else if (args[0] == SYS_GETDENTS) {
+    struct dirent* entries = (struct dirent*)args[2];
+    size_t cnt = (size_t)args[3];
+
+    /* Validate the whole user buffer before touching any state */
+    validate_pointer(&args[3], sizeof(args[3]));
+    if (cnt > SIZE_MAX / sizeof(struct dirent)) {
+      thread_current()->pcb->wait_status->exit_code = -1;
+      return process_exit();
+    }
+    validate_buffer(entries, cnt * sizeof(struct dirent));
+
+    lock_acquire(&syscall_lock);
+    struct file_dir* potential_directory = get_file_wrapper(args);
+    if (potential_directory == NULL || !potential_directory->isdir) {
+      f->eax = -1;
+      lock_release(&syscall_lock);
+      return;
+    }
+
+    f->eax = dir_readdir_batch(potential_directory->dir, entries, cnt);
+    lock_release(&syscall_lock);
+  }
+
+  /* fsync syscall */
+  else if (args[0] == SYS_FSYNC) {
+    lock_acquire(&syscall_lock);
+    struct file_dir* file_dir = get_file_wrapper(args);
+    if (file_dir == NULL) {
+      f->eax = false;
+      lock_release(&syscall_lock);
+      return;
+    }
+    struct inode* inode =
+        file_dir->isdir ? dir_get_inode(file_dir->dir) : file_get_inode(file_dir->file);
+    block_sector_t sector = inode_get_inumber(inode);
+    lock_release(&syscall_lock);
+
+    /* Flush without holding syscall_lock, so other processes'
+       file system calls don't wait on this file's I/O */
+    inode_flush(sector);
+    f->eax = true;
+  }
+
+  /* sync syscall */
+  else if (args[0] == SYS_SYNC) {
+    filesys_sync();
+  }
+
+  /* fallocate and truncate syscalls */
+  else if (args[0] == SYS_FALLOCATE || args[0] == SYS_TRUNCATE) {
+    validate_pointer(&args[2], sizeof(args[2]));
+    off_t length = (off_t)args[2];
+
+    lock_acquire(&syscall_lock);
+    struct file_dir* file_dir = get_file_wrapper(args);
+    if (file_dir == NULL || file_dir->isdir) {
+      f->eax = false;
+      lock_release(&syscall_lock);
+      return;
+    }
+    struct inode* inode = file_get_inode(file_dir->file);
+    if (args[0] == SYS_FALLOCATE)
+      f->eax = inode_allocate(inode, length);
+    else
+      f->eax = inode_truncate(inode, length);
+    lock_release(&syscall_lock);
+  }
+
+  /* compress syscall */
+  else if (args[0] == SYS_COMPRESS) {
+    validate_pointer(&args[2], sizeof(args[2]));
+
+    lock_acquire(&syscall_lock);
+    struct file_dir* file_dir = get_file_wrapper(args);
+    if (file_dir == NULL || file_dir->isdir) {
+      f->eax = false;
+      lock_release(&syscall_lock);
+      return;
+    }
+    f->eax = inode_set_compress(file_get_inode(file_dir->file), args[2] != 0);
+    lock_release(&syscall_lock);
+  }
+
+  /* defrag syscall */
+  else if (args[0] == SYS_DEFRAG) {
+    int* before = (int*)args[2];
+    int* after = (int*)args[3];
+
+    validate_pointer(&args[3], sizeof(args[3]));
+    validate_pointer(before, sizeof(int) - 1);
+    validate_pointer(after, sizeof(int) - 1);
+
+    lock_acquire(&syscall_lock);
+    struct file_dir* file_dir = get_file_wrapper(args);
+    if (file_dir == NULL || file_dir->isdir) {
+      f->eax = false;
+      lock_release(&syscall_lock);
+      return;
+    }
+    struct inode* inode = inode_reopen(file_get_inode(file_dir->file));
+    lock_release(&syscall_lock);
+
+    /* Move the blocks without holding syscall_lock; the inode
+       holds off this file's reads and writes itself */
+    int extents_before = 0, extents_after = 0;
+    f->eax = inode_defrag(inode, &extents_before, &extents_after);
+    inode_close(inode);
+    *before = extents_before;
+    *after = extents_after;
+  }
+
+  /* statfs syscall */
+  else if (args[0] == SYS_STATFS) {
+    struct statfs* st = (struct statfs*)args[1];
+    validate_pointer(st, sizeof *st - 1);
+    filesys_statfs(st);
+  }
+
+#ifdef VM
+  /* mmap syscall */
+  else if (args[0] == SYS_MMAP) {
+    validate_pointer(&args[2], sizeof(args[2]));
+
+    lock_acquire(&syscall_lock);
+    struct file_dir* file_dir = get_file_wrapper(args);
+    if (file_dir == NULL || file_dir->isdir) {
+      f->eax = MAP_FAILED;
+    } else {
+      f->eax = mmap_map(file_dir->file, (void*)args[2]);
+    }
+    lock_release(&syscall_lock);
+  }
+
+  /* munmap syscall */
+  else if (args[0] == SYS_MUNMAP) {
+    lock_acquire(&syscall_lock);
+    mmap_unmap(args[1]);
+    lock_release(&syscall_lock);
+  }
+#endif
 }
 
 // HELPER METHODS
@@ -406,11 +613,44 @@ struct file_dir* get_file_wrapper(uint32_t* args) {
 
 /* Check file_name valid location in vaddr && pagedir */
 bool check_valid_location(void* file_name) {
+  if (!is_user_vaddr(file_name)) {
+    return 0;
+  }
+#ifdef VM
+  /* Load the page if the process hasn't touched it yet */
+  return page_load(file_name) || (page_grow_stack(file_name, thread_current()->user_esp) &&
+                                  page_load(file_name));
+#else
   struct process* pcb = thread_current()->pcb;
-  if (!is_user_vaddr(file_name) || !pagedir_get_page(pcb->pagedir, file_name)) {
+  if (!pagedir_get_page(pcb->pagedir, file_name)) {
     return 0;
   }
   return 1;
+#endif
+}
+
+/* Validates the SIZE bytes at ptr by exiting with code -1 if any page they touch is an invalid memory addr */
+void validate_buffer(void* ptr, size_t size) {
+  uint8_t* start = ptr;
+  uint8_t* last = start + size - 1;
+  uint8_t* page;
+
+  if (size == 0)
+    return;
+  if (last < start) {
+    thread_current()->pcb->wait_status->exit_code = -1;
+    return process_exit();
+  }
+
+  /* Check the first byte, then the start of every later page */
+  for (page = start; page <= last; page = (uint8_t*)pg_round_down(page) + PGSIZE) {
+    if (!check_valid_location(page)) {
+      thread_current()->pcb->wait_status->exit_code = -1;
+      return process_exit();
+    }
+    if (pg_round_down(page) == pg_round_down(last))
+      break;
+  }
 }
 
 /* Validates ptr by exiting with code -1 if ptr is an invalid memory addr or invalid pointer */
@@ -424,7 +664,9 @@ void validate_pointer(void* ptr, size_t size) {
 /* Validates string by exiting with code -1 if string maps to invalid pg or its contents are not in user space */
 void validate_string(char* string) {
   if (is_user_vaddr(string)) {
-    char* pg = pagedir_get_page(thread_current()->pcb->pagedir, string);
+    char* pg = check_valid_location(string)
+                   ? pagedir_get_page(thread_current()->pcb->pagedir, string)
+                   : NULL;
     if (pg == NULL || !check_valid_location(string + strlen(pg) + 1)) {
       thread_current()->pcb->wait_status->exit_code = -1;
       return process_exit();
@@ -0,0 +1,343 @@
+/* Builds a Pintos file system partition image on the host.
+
+   Usage: pintos-mkfs [-s MB] IMAGE [FILE[=NAME]]...
+
+   Formats IMAGE in the on-disk format used by filesys/ and
+   copies each FILE into the root directory under NAME, which
+   defaults to the last component of FILE.  The result can be
+   handed straight to the simulator, e.g.
+
+     pintos-mkfs fs.img tests/userprog/args-none
+     pintos --filesys=fs.img -- -q run args-none
+
+   which avoids booting the kernel once just to "extract" files
+   from a scratch disk.  Do not pass -f to the kernel, since that
+   would reformat the image.
+
+   The layout must be kept in sync with filesys/inode.h,
+   filesys/directory.h, filesys/filesys.h, filesys/cache.c, and
+   lib/kernel/bitmap.c. */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SECTOR_SIZE 512 /* BLOCK_SECTOR_SIZE. */
+
+#define FREE_MAP_SECTOR 0 /* Free map file inode sector. */
+#define ROOT_DIR_SECTOR 1 /* Root directory file inode sector. */
+#define WARMUP_SECTOR 2   /* Cache warm-up list, written empty. */
+
+#define WARMUP_MAGIC 0x4d524157 /* Identifies a warm-up list. */
+
+#define INODE_MAGIC 0x494e4f44 /* Identifies an inode. */
+#define TOTAL_DIRECT 12        /* Direct pointers per inode. */
+#define NUM_INDIRECT 128       /* Pointers per indirect block. */
+
+#define NAME_MAX 14         /* Longest file name. */
+#define DIR_ENTRY_SIZE 20   /* sizeof (struct dir_entry). */
+#define ROOT_DIR_ENTRIES 16 /* Entries the kernel's do_format() reserves. */
+
+#define CYLINDER_SECTORS (16 * 63) /* Default disk geometry in Pintos.pm. */
+
+/* Byte offsets of the fields of struct inode_disk. */
+#define ID_LENGTH 0
+#define ID_ISDIR 4
+#define ID_FILES_REM 8
+#define ID_MAGIC 12
+#define ID_DIRECT 16
+#define ID_INDIRECT (ID_DIRECT + 4 * TOTAL_DIRECT)
+#define ID_DOUBLY_INDIRECT (ID_INDIRECT + 4)
+
+static uint8_t* image;       /* Image contents, SECTOR_CNT sectors. */
+static uint32_t sector_cnt;  /* Number of sectors in image. */
+static uint32_t next_sector; /* Next free sector. */
+
+static void fail(const char* msg, ...) __attribute__((noreturn))
+__attribute__((format(printf, 1, 2)));
+
+/* Prints MSG, formatting as with printf(),
+   plus an error message based on errno if nonzero,
+   and exits. */
+static void fail(const char* msg, ...) {
+  va_list args;
+
+  va_start(args, msg);
+  fprintf(stderr, "pintos-mkfs: ");
+  vfprintf(stderr, msg, args);
+  va_end(args);
+
+  if (errno != 0)
+    fprintf(stderr, ": %s", strerror(errno));
+  putc('\n', stderr);
+  exit(EXIT_FAILURE);
+}
+
+static void usage(int exit_code) __attribute__((noreturn));
+
+/* Prints a usage message and exits with EXIT_CODE. */
+static void usage(int exit_code) {
+  printf("pintos-mkfs, a Pintos file system image builder\n"
+         "Usage: pintos-mkfs [-s MB] IMAGE [FILE[=NAME]]...\n"
+         "Formats IMAGE as a Pintos file system partition and copies each\n"
+         "FILE into its root directory as NAME (by default, FILE's base name).\n"
+         "Options:\n"
+         "  -s MB     Make IMAGE MB megabytes long (default: 2)\n"
+         "  -h        Display this help message\n");
+  exit(exit_code);
+}
+
+/* Returns a pointer to the start of SECTOR in the image. */
+static uint8_t* sector_data(uint32_t sector) { return image + (size_t)sector * SECTOR_SIZE; }
+
+/* Stores VALUE at P in little-endian byte order, as the i386
+   kernel expects. */
+static void put_u32(uint8_t* p, uint32_t value) {
+  p[0] = value;
+  p[1] = value >> 8;
+  p[2] = value >> 16;
+  p[3] = value >> 24;
+}
+
+/* Returns the little-endian value stored at P. */
+static uint32_t get_u32(const uint8_t* p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/* Returns a pointer to data block IDX of the file whose inode is
+   in INODE_SECTOR, which must already be allocated. */
+static uint8_t* file_block(uint32_t inode_sector, uint32_t idx) {
+  uint8_t* id = sector_data(inode_sector);
+  const uint8_t* indirect;
+
+  if (idx < TOTAL_DIRECT)
+    return sector_data(get_u32(id + ID_DIRECT + 4 * idx));
+  idx -= TOTAL_DIRECT;
+  if (idx < NUM_INDIRECT)
+    indirect = sector_data(get_u32(id + ID_INDIRECT));
+  else {
+    idx -= NUM_INDIRECT;
+    indirect = sector_data(get_u32(id + ID_DOUBLY_INDIRECT));
+    indirect = sector_data(get_u32(indirect + 4 * (idx / NUM_INDIRECT)));
+    idx %= NUM_INDIRECT;
+  }
+  return sector_data(get_u32(indirect + 4 * idx));
+}
+
+/* Copies LENGTH bytes from DATA into the blocks of the file
+   whose inode is in INODE_SECTOR. */
+static void fill_inode(uint32_t inode_sector, const uint8_t* data, uint32_t length) {
+  for (uint32_t ofs = 0; ofs < length; ofs += SECTOR_SIZE) {
+    uint32_t chunk = length - ofs < SECTOR_SIZE ? length - ofs : SECTOR_SIZE;
+    memcpy(file_block(inode_sector, ofs / SECTOR_SIZE), data + ofs, chunk);
+  }
+}
+
+/* Returns the next free sector.  Sectors are handed out in
+   ascending order, so every file ends up contiguous. */
+static uint32_t alloc_sector(void) {
+  if (next_sector >= sector_cnt) {
+    errno = 0;
+    fail("image full (%u sectors); use a larger -s", sector_cnt);
+  }
+  return next_sector++;
+}
+
+/* Creates an inode in INODE_SECTOR for a zeroed file LENGTH bytes
+   long, with the same block tree inode_resize() would build. */
+static void make_inode(uint32_t inode_sector, uint32_t length, bool isdir, uint32_t files_rem) {
+  uint8_t* id = sector_data(inode_sector);
+  uint32_t sectors = (length + SECTOR_SIZE - 1) / SECTOR_SIZE;
+  uint8_t* indirect = NULL;
+  uint8_t* doubly_indirect = NULL;
+
+  if (sectors > TOTAL_DIRECT + NUM_INDIRECT + NUM_INDIRECT * NUM_INDIRECT) {
+    errno = 0;
+    fail("%u bytes is larger than the largest Pintos file", length);
+  }
+
+  put_u32(id + ID_LENGTH, length);
+  put_u32(id + ID_ISDIR, isdir);
+  put_u32(id + ID_FILES_REM, files_rem);
+  put_u32(id + ID_MAGIC, INODE_MAGIC);
+
+  for (uint32_t i = 0; i < sectors; i++) {
+    uint8_t* ptr;
+
+    /* Find the pointer to data block I, allocating index
+       blocks along the way. */
+    if (i < TOTAL_DIRECT)
+      ptr = id + ID_DIRECT + 4 * i;
+    else if (i < TOTAL_DIRECT + NUM_INDIRECT) {
+      if (indirect == NULL) {
+        uint32_t s = alloc_sector();
+        put_u32(id + ID_INDIRECT, s);
+        indirect = sector_data(s);
+      }
+      ptr = indirect + 4 * (i - TOTAL_DIRECT);
+    } else {
+      uint32_t j = i - TOTAL_DIRECT - NUM_INDIRECT;
+      if (doubly_indirect == NULL) {
+        uint32_t s = alloc_sector();
+        put_u32(id + ID_DOUBLY_INDIRECT, s);
+        doubly_indirect = sector_data(s);
+      }
+      if (j % NUM_INDIRECT == 0) {
+        uint32_t s = alloc_sector();
+        put_u32(doubly_indirect + 4 * (j / NUM_INDIRECT), s);
+        indirect = sector_data(s);
+      }
+      ptr = indirect + 4 * (j % NUM_INDIRECT);
+    }
+
+    put_u32(ptr, alloc_sector());
+  }
+}
+
+/* Fills in directory entry IDX of the directory whose contents
+   are DIR with NAME, naming INODE_SECTOR. */
+static void put_dir_entry(uint8_t* dir, size_t idx, const char* name, uint32_t inode_sector) {
+  uint8_t* e = dir + idx * DIR_ENTRY_SIZE;
+  put_u32(e, inode_sector);
+  strncpy((char*)e + 4, name, NAME_MAX);
+  e[4 + NAME_MAX + 1] = 1; /* in_use. */
+}
+
+/* Reads all of FILE_NAME into a newly allocated buffer, storing
+   its length into *LENGTH. */
+static uint8_t* read_file(const char* file_name, uint32_t* length) {
+  FILE* file = fopen(file_name, "rb");
+  uint8_t* data;
+  long size;
+
+  if (file == NULL)
+    fail("%s: open", file_name);
+  if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) != 0)
+    fail("%s: seek", file_name);
+
+  data = malloc(size > 0 ? size : 1);
+  if (data == NULL)
+    fail("out of memory");
+  if (fread(data, 1, size, file) != (size_t)size)
+    fail("%s: read", file_name);
+  fclose(file);
+
+  *length = size;
+  return data;
+}
+
+int main(int argc, char* argv[]) {
+  const char* image_name;
+  double mb = 2.0;
+  size_t file_cnt, dir_entries, bitmap_bytes;
+  uint32_t bit_cnt;
+  uint8_t *root, *bitmap;
+  FILE* out;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:h")) != -1)
+    switch (opt) {
+      case 's':
+        mb = atof(optarg);
+        if (mb <= 0)
+          usage(EXIT_FAILURE);
+        break;
+      case 'h':
+        usage(EXIT_SUCCESS);
+      default:
+        usage(EXIT_FAILURE);
+    }
+  if (optind >= argc)
+    usage(EXIT_FAILURE);
+  image_name = argv[optind++];
+  file_cnt = argc - optind;
+
+  sector_cnt = mb * 1024 * 1024 / SECTOR_SIZE;
+  if (sector_cnt <= WARMUP_SECTOR + 2) {
+    errno = 0;
+    fail("%g MB is too small for a file system", mb);
+  }
+  image = calloc(sector_cnt, SECTOR_SIZE);
+  if (image == NULL)
+    fail("out of memory");
+  next_sector = WARMUP_SECTOR + 1;
+
+  /* An empty cache warm-up list, so the kernel knows the sector
+     is reserved for the list and may overwrite it at shutdown. */
+  put_u32(sector_data(WARMUP_SECTOR), WARMUP_MAGIC);
+
+  /* Free map file, one bit per sector, stored as an array of
+     32-bit words like struct bitmap, so its length must match
+     bitmap_file_size().  It is sized for the image rounded up to
+     a whole cylinder, because pintos-mkdisk may pad the partition
+     that far and the kernel reads one bit per sector of the
+     partition. */
+  bit_cnt = (sector_cnt + CYLINDER_SECTORS - 1) / CYLINDER_SECTORS * CYLINDER_SECTORS;
+  bitmap_bytes = (bit_cnt + 31) / 32 * 4;
+  make_inode(FREE_MAP_SECTOR, bitmap_bytes, false, 0);
+
+  /* Root directory, with room for at least as many entries as
+     the kernel's formatter reserves, plus "." and "..".  Its
+     entries are filled in once each file has an inode. */
+  dir_entries = (file_cnt > ROOT_DIR_ENTRIES ? file_cnt : ROOT_DIR_ENTRIES) + 2;
+  make_inode(ROOT_DIR_SECTOR, dir_entries * DIR_ENTRY_SIZE, true, file_cnt);
+  root = calloc(dir_entries, DIR_ENTRY_SIZE);
+  if (root == NULL)
+    fail("out of memory");
+  put_dir_entry(root, 0, "..", ROOT_DIR_SECTOR);
+  put_dir_entry(root, 1, ".", ROOT_DIR_SECTOR);
+
+  /* Files. */
+  for (size_t i = 0; i < file_cnt; i++) {
+    char* src = argv[optind + i];
+    char* name = strchr(src, '=');
+    uint32_t inode_sector, length;
+    uint8_t* data;
+
+    if (name != NULL)
+      *name++ = '\0';
+    else {
+      name = strrchr(src, '/');
+      name = name != NULL ? name + 1 : src;
+    }
+    errno = 0;
+    if (*name == '\0' || strlen(name) > NAME_MAX || strchr(name, '/') != NULL)
+      fail("%s: invalid file name (at most %d characters, no slashes)", name, NAME_MAX);
+    for (size_t j = 0; j < i; j++)
+      if (!strncmp((char*)root + (j + 2) * DIR_ENTRY_SIZE + 4, name, NAME_MAX))
+        fail("%s: duplicate file name", name);
+
+    data = read_file(src, &length);
+    inode_sector = alloc_sector();
+    make_inode(inode_sector, length, false, 0);
+    fill_inode(inode_sector, data, length);
+    put_dir_entry(root, i + 2, name, inode_sector);
+    free(data);
+  }
+
+  /* Fill in the root directory and, now that every sector has
+     been allocated, the free map. */
+  fill_inode(ROOT_DIR_SECTOR, root, dir_entries * DIR_ENTRY_SIZE);
+  bitmap = calloc(1, bitmap_bytes);
+  if (bitmap == NULL)
+    fail("out of memory");
+  for (uint32_t s = 0; s < next_sector; s++)
+    bitmap[s / 8] |= 1 << (s % 8);
+  fill_inode(FREE_MAP_SECTOR, bitmap, bitmap_bytes);
+
+  /* Write the image. */
+  out = fopen(image_name, "wb");
+  if (out == NULL)
+    fail("%s: create", image_name);
+  if (fwrite(image, SECTOR_SIZE, sector_cnt, out) != sector_cnt || fclose(out) != 0)
+    fail("%s: write", image_name);
+
+  printf("%s: %u sectors, %zu file(s), %u sectors used\n", image_name, sector_cnt, file_cnt,
+         next_sector);
+  return EXIT_SUCCESS;
+}
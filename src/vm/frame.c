@@ -0,0 +1,159 @@
+/* Frame table.
+
+   Every frame of user memory that holds a process's page is in
+   the frame table, a list that a clock hand sweeps to pick a
+   frame to evict when the user pool runs out.  A frame whose
+   page was accessed since the hand last passed gets a second
+   chance: its accessed bit is cleared and the hand moves on.
+
+   Locking: frame_lock protects the list, the clock hand and
+   each frame's PAGE and PINNED members.  Each page has its own
+   lock, held while the page is loaded into or evicted from a
+   frame.  The clock only tries to acquire page locks, skipping
+   pages that are busy, so a process loading its own page (and
+   holding that page's lock) can evict another process's page
+   without deadlock.  Evicted pages are written out with only
+   their page lock held, so other processes can keep faulting
+   while the disk is busy.
+
+   Frames shared by several processes (see share.c) belong to no
+   single page and stay pinned until the last process unmaps
+   them. */
+
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "vm/page.h"
+
+static struct list frames;      /* Frames in use. */
+static struct list_elem* hand;  /* Clock hand, or list_end(&frames). */
+static struct lock frame_lock;  /* Protects the above and frames. */
+static size_t frame_cnt;        /* Number of frames in FRAMES. */
+static long long evict_cnt;     /* Number of frames evicted. */
+static struct slab_cache* frame_cache;
+
+static struct frame* evict(void);
+
+/* Initializes the frame table. */
+void frame_init(void) {
+  list_init(&frames);
+  hand = list_end(&frames);
+  lock_init(&frame_lock);
+  frame_cache = slab_cache_create("frame", sizeof(struct frame), NULL);
+}
+
+/* Obtains a frame for PAGE, evicting another page if the user
+   pool is exhausted.  The frame is returned pinned.  Returns a
+   null pointer if no frame can be freed. */
+struct frame* frame_alloc(struct page* page) {
+  struct frame* f;
+  void* kpage = palloc_get_page(PAL_USER);
+
+  if (kpage == NULL) {
+    f = evict();
+    if (f != NULL)
+      f->page = page;
+    return f;
+  }
+
+  f = slab_alloc(frame_cache);
+  if (f == NULL) {
+    palloc_free_page(kpage);
+    return NULL;
+  }
+  f->kpage = kpage;
+  f->page = page;
+  f->pinned = true;
+
+  lock_acquire(&frame_lock);
+  list_push_back(&frames, &f->elem);
+  frame_cnt++;
+  lock_release(&frame_lock);
+  return f;
+}
+
+/* Removes F from the frame table and frees it.  The caller must
+   hold F's page's lock, if it has one, and must already have
+   unmapped it. */
+void frame_free(struct frame* f) {
+  lock_acquire(&frame_lock);
+  if (hand == &f->elem)
+    hand = list_next(hand);
+  list_remove(&f->elem);
+  frame_cnt--;
+  lock_release(&frame_lock);
+
+  palloc_free_page(f->kpage);
+  slab_free(frame_cache, f);
+}
+
+/* Prevents F from being evicted until frame_unpin(). */
+void frame_pin(struct frame* f) {
+  lock_acquire(&frame_lock);
+  f->pinned = true;
+  lock_release(&frame_lock);
+}
+
+/* Allows F to be evicted again. */
+void frame_unpin(struct frame* f) {
+  lock_acquire(&frame_lock);
+  f->pinned = false;
+  lock_release(&frame_lock);
+}
+
+/* Prints frame table statistics. */
+void frame_print_stats(void) {
+  printf("Frames: %zu in use, %lld evicted\n", frame_cnt, evict_cnt);
+}
+
+/* Advances the clock hand and returns the frame it passes. */
+static struct frame* clock_next(void) {
+  if (hand == list_end(&frames))
+    hand = list_begin(&frames);
+  struct frame* f = list_entry(hand, struct frame, elem);
+  hand = list_next(hand);
+  return f;
+}
+
+/* Chooses a frame with the clock algorithm, writes out its page
+   and returns the frame, pinned.  Returns a null pointer if
+   every frame is pinned, busy, or holds a dirty page that swap
+   has no room for. */
+static struct frame* evict(void) {
+  size_t i;
+
+  lock_acquire(&frame_lock);
+
+  /* Two passes over the table clear every accessed bit, so a
+     third finds a victim if there is one. */
+  for (i = 0; i < 3 * frame_cnt; i++) {
+    struct frame* f = clock_next();
+    struct page* p = f->page;
+
+    if (f->pinned || !lock_try_acquire(&p->lock))
+      continue;
+    if (page_accessed_recently(p)) {
+      lock_release(&p->lock);
+      continue;
+    }
+
+    f->pinned = true;
+    lock_release(&frame_lock);
+    bool evicted = page_evict(p);
+    lock_release(&p->lock);
+    lock_acquire(&frame_lock);
+
+    if (evicted) {
+      evict_cnt++;
+      lock_release(&frame_lock);
+      return f;
+    }
+    f->pinned = false;
+  }
+
+  lock_release(&frame_lock);
+  return NULL;
+}
@@ -0,0 +1,24 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <list.h>
+#include <stdbool.h>
+
+struct page;
+
+/* A frame of user memory holding a page. */
+struct frame {
+  void* kpage;           /* Kernel virtual address of the frame. */
+  struct page* page;     /* Page held in the frame, or null if shared. */
+  bool pinned;           /* May not be evicted while true. */
+  struct list_elem elem; /* Element in frame table. */
+};
+
+void frame_init(void);
+struct frame* frame_alloc(struct page*);
+void frame_free(struct frame*);
+void frame_pin(struct frame*);
+void frame_unpin(struct frame*);
+void frame_print_stats(void);
+
+#endif /* vm/frame.h */
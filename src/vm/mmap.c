@@ -0,0 +1,110 @@
+/* Memory-mapped files.
+
+   A mapping adds one page to the process's supplemental page
+   table for each page of the file, marked so that the page is
+   read from the file on first touch and, if dirty, written back
+   to it on eviction or unmapping instead of going to swap.  The
+   mapping has its own reopened file, so it outlives closing or
+   removing the file it was made from. */
+
+#include "vm/mmap.h"
+#include <debug.h>
+#include <round.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include "vm/page.h"
+
+static void unmap(struct mapping*);
+
+/* Maps FILE into the current process's address space starting at
+   ADDR, which must be page-aligned.  Returns the new mapping's
+   identifier, or MAP_FAILED if FILE is empty, ADDR is null or
+   misaligned, or any page of the range is already in use. */
+mapid_t mmap_map(struct file* file, void* addr) {
+  struct process* pcb = thread_current()->pcb;
+  struct mapping* m;
+  off_t length;
+  size_t page_cnt, i;
+
+  if (addr == NULL || pg_ofs(addr) != 0)
+    return MAP_FAILED;
+  length = file_length(file);
+  if (length <= 0)
+    return MAP_FAILED;
+
+  /* Check the whole range first, so that a failed mapping doesn't
+     touch the address space. */
+  page_cnt = DIV_ROUND_UP(length, PGSIZE);
+  for (i = 0; i < page_cnt; i++) {
+    void* upage = (uint8_t*)addr + i * PGSIZE;
+    if (!is_user_vaddr(upage) || page_lookup(upage) != NULL)
+      return MAP_FAILED;
+  }
+
+  m = malloc(sizeof *m);
+  if (m == NULL)
+    return MAP_FAILED;
+  m->file = file_reopen(file);
+  if (m->file == NULL) {
+    free(m);
+    return MAP_FAILED;
+  }
+  m->id = pcb->next_mapid++;
+  m->addr = addr;
+  m->page_cnt = 0;
+  list_push_back(&pcb->mappings, &m->elem);
+
+  for (i = 0; i < page_cnt; i++) {
+    off_t ofs = i * PGSIZE;
+    size_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+    struct page* p = page_add((uint8_t*)addr + ofs, m->file, ofs, read_bytes, true);
+    if (p == NULL) {
+      unmap(m);
+      return MAP_FAILED;
+    }
+    p->mapped = true;
+    m->page_cnt++;
+  }
+  return m->id;
+}
+
+/* Unmaps the current process's mapping with identifier ID,
+   writing back its dirty pages.  Returns false if there is no
+   such mapping. */
+bool mmap_unmap(mapid_t id) {
+  struct list* mappings = &thread_current()->pcb->mappings;
+  struct list_elem* e;
+
+  for (e = list_begin(mappings); e != list_end(mappings); e = list_next(e)) {
+    struct mapping* m = list_entry(e, struct mapping, elem);
+    if (m->id == id) {
+      unmap(m);
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Unmaps all of the current process's mappings, writing back
+   their dirty pages. */
+void mmap_unmap_all(void) {
+  struct list* mappings = &thread_current()->pcb->mappings;
+
+  while (!list_empty(mappings))
+    unmap(list_entry(list_front(mappings), struct mapping, elem));
+}
+
+/* Removes M's pages from the address space, writing back the
+   dirty ones, and frees M. */
+static void unmap(struct mapping* m) {
+  size_t i;
+
+  for (i = 0; i < m->page_cnt; i++)
+    page_remove((uint8_t*)m->addr + i * PGSIZE);
+  list_remove(&m->elem);
+  file_close(m->file);
+  free(m);
+}
@@ -0,0 +1,27 @@
+#ifndef VM_MMAP_H
+#define VM_MMAP_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct file;
+
+/* Map region identifier. */
+typedef int mapid_t;
+#define MAP_FAILED ((mapid_t)-1)
+
+/* A memory-mapped file. */
+struct mapping {
+  mapid_t id;            /* Mapping identifier. */
+  struct file* file;     /* File mapped, reopened for the mapping. */
+  void* addr;            /* User virtual address of first page. */
+  size_t page_cnt;       /* Number of pages mapped. */
+  struct list_elem elem; /* Element in process's list of mappings. */
+};
+
+mapid_t mmap_map(struct file*, void* addr);
+bool mmap_unmap(mapid_t);
+void mmap_unmap_all(void);
+
+#endif /* vm/mmap.h */
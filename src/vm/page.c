@@ -0,0 +1,356 @@
+/* Supplemental page table.
+
+   Each process keeps a hash table, keyed by user virtual page,
+   of the pages that make up its address space.  An entry says
+   where the page's contents are: in a frame, in a swap slot, or
+   still only in their original source, a range of a file
+   followed by zeros or all zeros.  load() only has to record
+   each page of the executable instead of reading it.  The first
+   time the process touches a page, the page fault handler calls
+   page_load() to bring the contents into a frame and map it.
+
+   The stack starts out as a single page.  A fault just below
+   it, no further below the stack pointer than PUSHA writes, adds
+   another zero page with page_grow_stack(), up to
+   MAX_STACK_PAGES in all.
+
+   When the frame table evicts a page, page_evict() writes it to
+   swap if it is dirty and otherwise just drops it, since its
+   contents can be read again from their source.  A page read
+   back from swap is marked dirty, so it goes back to swap the
+   next time it is evicted.  Pages of memory-mapped files are
+   never swapped: if dirty, they are written back to the file,
+   on eviction and when they are unmapped.
+
+   Read-only pages of an executable are instead mapped from a
+   frame shared with every other process running it (see
+   share.c), which is never evicted while in use.
+
+   Kernel code that touches user memory while holding file
+   system locks must not take a page fault, since loading the
+   page may need the same locks or the same disk.  System calls
+   pin their user buffers with page_pin_range() before they
+   start. */
+
+#include "vm/page.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/slab.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/frame.h"
+#include "vm/share.h"
+#include "vm/swap.h"
+
+/* Cache that page table entries are allocated from. */
+static struct slab_cache* page_cache;
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static bool load(struct page*);
+static void release(struct page*);
+
+/* Initializes the supplemental page table module. */
+void page_init(void) { page_cache = slab_cache_create("page", sizeof(struct page), NULL); }
+
+/* Initializes PAGES as an empty page table.  Returns false if
+   memory allocation fails. */
+bool page_table_init(struct hash* pages) { return hash_init(pages, page_hash, page_less, NULL); }
+
+/* Releases and frees the page for hash element E. */
+static void page_destroy(struct hash_elem* e, void* aux UNUSED) {
+  struct page* p = hash_entry(e, struct page, hash_elem);
+  release(p);
+  slab_free(page_cache, p);
+}
+
+/* Frees PAGES and all of its entries.  Must be called before
+   the page directory they map into is destroyed. */
+void page_table_destroy(struct hash* pages) { hash_destroy(pages, page_destroy); }
+
+/* Adds UPAGE to the current process's address space, with
+   contents READ_BYTES bytes of FILE starting at OFS followed by
+   zeros.  FILE may be a null pointer if READ_BYTES is 0.  The
+   page is not loaded until it is first touched.  Returns the new
+   page, or a null pointer if UPAGE is already in the address
+   space or if memory allocation fails. */
+struct page* page_add(void* upage, struct file* file, off_t ofs, size_t read_bytes, bool writable) {
+  struct process* pcb = thread_current()->pcb;
+  struct page* p;
+
+  ASSERT(pg_ofs(upage) == 0);
+  ASSERT(is_user_vaddr(upage));
+  ASSERT(read_bytes <= PGSIZE);
+  ASSERT(file != NULL || read_bytes == 0);
+
+  p = slab_alloc(page_cache);
+  if (p == NULL)
+    return NULL;
+  p->upage = upage;
+  p->writable = writable;
+  p->pagedir = pcb->pagedir;
+  lock_init(&p->lock);
+  p->frame = NULL;
+  p->share = NULL;
+  p->swap_slot = SWAP_ERROR;
+  p->file = file;
+  p->ofs = ofs;
+  p->read_bytes = read_bytes;
+  p->mapped = false;
+
+  if (hash_insert(&pcb->pages, &p->hash_elem) != NULL) {
+    slab_free(page_cache, p);
+    return NULL;
+  }
+  return p;
+}
+
+/* Adds the page containing user virtual address UADDR to the
+   current process's stack, if UADDR is within MAX_STACK_PAGES of
+   the top of user memory and no more than 32 bytes below the
+   user stack pointer ESP.  The page is not loaded.  Returns true
+   if successful. */
+bool page_grow_stack(const void* uaddr, const void* esp) {
+  struct process* pcb = thread_current()->pcb;
+  const uint8_t* addr = uaddr;
+
+  if (pcb == NULL || pcb->pagedir == NULL || !is_user_vaddr(uaddr))
+    return false;
+
+  /* PUSHA checks permissions for all 32 bytes it pushes before
+     it moves the stack pointer. */
+  if (addr < (const uint8_t*)PHYS_BASE - MAX_STACK_PAGES * PGSIZE ||
+      addr + 32 < (const uint8_t*)esp)
+    return false;
+  return page_add(pg_round_down(uaddr), NULL, 0, 0, true) != NULL;
+}
+
+/* Removes UPAGE from the current process's address space,
+   writing it back to its file first if it is a dirty page of a
+   memory-mapped file. */
+void page_remove(const void* upage) {
+  struct page* p = page_lookup(upage);
+
+  ASSERT(p != NULL);
+  hash_delete(&thread_current()->pcb->pages, &p->hash_elem);
+  release(p);
+  slab_free(page_cache, p);
+}
+
+/* Returns the current process's page containing user virtual
+   address UADDR, or a null pointer if there is none. */
+struct page* page_lookup(const void* uaddr) {
+  struct process* pcb = thread_current()->pcb;
+  struct page p;
+  struct hash_elem* e;
+
+  /* Kernel threads and processes still being set up have no
+     page table. */
+  if (pcb == NULL || pcb->pagedir == NULL || !is_user_vaddr(uaddr))
+    return NULL;
+
+  p.upage = pg_round_down(uaddr);
+  e = hash_find(&pcb->pages, &p.hash_elem);
+  return e != NULL ? hash_entry(e, struct page, hash_elem) : NULL;
+}
+
+/* Makes the page containing user virtual address UADDR resident
+   in the current process.  Returns true if successful, false if
+   UADDR is not in the process's address space or if the page
+   can't be loaded. */
+bool page_load(const void* uaddr) {
+  struct page* p = page_lookup(uaddr);
+  bool success;
+
+  if (p == NULL)
+    return false;
+  lock_acquire(&p->lock);
+  success = p->frame != NULL || load(p);
+  lock_release(&p->lock);
+  return success;
+}
+
+/* Makes every page in the SIZE bytes of user memory starting at
+   UADDR resident in the current process and pins them in their
+   frames until page_unpin_range().  Returns false, leaving
+   nothing pinned, if any of the range is not in the address
+   space or can't be loaded, or if WRITE is true and any of it
+   is read-only. */
+bool page_pin_range(const void* uaddr, size_t size, bool write) {
+  const uint8_t* start = pg_round_down(uaddr);
+  const uint8_t* upage;
+
+  if (size == 0)
+    return true;
+  if ((uintptr_t)uaddr + size < (uintptr_t)uaddr)
+    return false;
+  for (upage = start; upage < (const uint8_t*)uaddr + size; upage += PGSIZE) {
+    struct page* p = page_lookup(upage);
+    bool success = false;
+
+    /* The buffer may be in stack the process hasn't touched yet. */
+    if (p == NULL && page_grow_stack(upage, thread_current()->user_esp))
+      p = page_lookup(upage);
+
+    if (p != NULL && (p->writable || !write)) {
+      lock_acquire(&p->lock);
+      if (p->frame != NULL || load(p)) {
+        if (p->share == NULL)
+          frame_pin(p->frame);
+        success = true;
+      }
+      lock_release(&p->lock);
+    }
+    if (!success) {
+      page_unpin_range(start, upage - start);
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Unpins the pages in the SIZE bytes of user memory starting at
+   UADDR, which must have been pinned with page_pin_range(). */
+void page_unpin_range(const void* uaddr, size_t size) {
+  const uint8_t* upage;
+
+  if (size == 0)
+    return;
+  for (upage = pg_round_down(uaddr); upage < (const uint8_t*)uaddr + size; upage += PGSIZE) {
+    struct page* p = page_lookup(upage);
+    ASSERT(p != NULL && p->frame != NULL);
+    if (p->share == NULL)
+      frame_unpin(p->frame);
+  }
+}
+
+/* Returns true if P, which must be resident and locked, was
+   accessed since the last call, and clears its accessed bit. */
+bool page_accessed_recently(struct page* p) {
+  ASSERT(lock_held_by_current_thread(&p->lock));
+  ASSERT(p->frame != NULL);
+
+  if (!pagedir_is_accessed(p->pagedir, p->upage))
+    return false;
+  pagedir_set_accessed(p->pagedir, p->upage, false);
+  return true;
+}
+
+/* Unmaps P, which must be resident and locked, and writes it to
+   swap, or back to its file for a memory-mapped file, if it is
+   dirty, so that its frame can be reused.  Returns false,
+   leaving P resident, if swap is full. */
+bool page_evict(struct page* p) {
+  ASSERT(lock_held_by_current_thread(&p->lock));
+  ASSERT(p->frame != NULL);
+
+  /* Unmap first, so that the process faults (and waits for our
+     lock) instead of writing to the page behind our back. */
+  pagedir_clear_page(p->pagedir, p->upage);
+  if (!pagedir_is_dirty(p->pagedir, p->upage)) {
+    /* Its contents can be read again from their source. */
+  } else if (p->mapped) {
+    file_write_at(p->file, p->frame->kpage, p->read_bytes, p->ofs);
+  } else {
+    p->swap_slot = swap_out(p->frame->kpage);
+    if (p->swap_slot == SWAP_ERROR) {
+      pagedir_set_page(p->pagedir, p->upage, p->frame->kpage, p->writable);
+      pagedir_set_dirty(p->pagedir, p->upage, true);
+      return false;
+    }
+  }
+  p->frame = NULL;
+  return true;
+}
+
+/* Brings P, which must be locked and not resident, into a new
+   or shared frame, maps it and unpins the frame.  Returns true if
+   successful, false if no frame is available or the page can't
+   be read. */
+static bool load(struct page* p) {
+  bool swapped = p->swap_slot != SWAP_ERROR;
+  struct frame* f;
+  uint8_t* kpage;
+
+  ASSERT(lock_held_by_current_thread(&p->lock));
+  ASSERT(p->frame == NULL);
+
+  /* Map read-only executable pages from the shared frame. */
+  if (p->file != NULL && !p->writable && !p->mapped) {
+    p->share = share_acquire(p->file, p->ofs, p->read_bytes);
+    if (p->share == NULL)
+      return false;
+    if (!pagedir_set_page(p->pagedir, p->upage, p->share->frame->kpage, false)) {
+      share_release(p->share);
+      p->share = NULL;
+      return false;
+    }
+    p->frame = p->share->frame;
+    return true;
+  }
+
+  f = frame_alloc(p);
+  if (f == NULL)
+    return false;
+  kpage = f->kpage;
+
+  if (swapped) {
+    swap_in(p->swap_slot, kpage);
+    p->swap_slot = SWAP_ERROR;
+  } else {
+    if (p->read_bytes > 0 &&
+        file_read_at(p->file, kpage, p->read_bytes, p->ofs) != (off_t)p->read_bytes) {
+      frame_free(f);
+      return false;
+    }
+    memset(kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+  }
+
+  if (!pagedir_set_page(p->pagedir, p->upage, kpage, p->writable)) {
+    frame_free(f);
+    return false;
+  }
+
+  /* The only copy of a page read from swap is now in memory. */
+  if (swapped)
+    pagedir_set_dirty(p->pagedir, p->upage, true);
+  p->frame = f;
+  frame_unpin(f);
+  return true;
+}
+
+/* Unmaps P, writing it back to its file first if it is a dirty
+   page of a memory-mapped file, and releases its frame, shared
+   frame or swap slot. */
+static void release(struct page* p) {
+  /* Wait for the frame table to finish evicting the page. */
+  lock_acquire(&p->lock);
+  if (p->share != NULL) {
+    pagedir_clear_page(p->pagedir, p->upage);
+    share_release(p->share);
+  } else if (p->frame != NULL) {
+    pagedir_clear_page(p->pagedir, p->upage);
+    if (p->mapped && pagedir_is_dirty(p->pagedir, p->upage))
+      file_write_at(p->file, p->frame->kpage, p->read_bytes, p->ofs);
+    frame_free(p->frame);
+  }
+  if (p->swap_slot != SWAP_ERROR)
+    swap_free(p->swap_slot);
+  lock_release(&p->lock);
+}
+
+/* Returns a hash value for the page with hash element E. */
+static unsigned page_hash(const struct hash_elem* e, void* aux UNUSED) {
+  const struct page* p = hash_entry(e, struct page, hash_elem);
+  return hash_bytes(&p->upage, sizeof p->upage);
+}
+
+/* Returns true if page A precedes page B. */
+static bool page_less(const struct hash_elem* a_, const struct hash_elem* b_, void* aux UNUSED) {
+  const struct page* a = hash_entry(a_, struct page, hash_elem);
+  const struct page* b = hash_entry(b_, struct page, hash_elem);
+  return a->upage < b->upage;
+}
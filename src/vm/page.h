@@ -0,0 +1,55 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+struct file;
+struct frame;
+struct share;
+
+/* A page of a process's user virtual address space, which may
+   or may not currently be resident in a frame. */
+struct page {
+  void* upage;       /* User virtual address of the page. */
+  bool writable;     /* May the user process write the page? */
+  uint32_t* pagedir; /* Page directory of the owning process. */
+
+  struct lock lock;    /* Protects FRAME and SWAP_SLOT. */
+  struct frame* frame; /* Frame holding the page, or a null pointer. */
+  struct share* share; /* Shared page mapping FRAME, or a null pointer. */
+  size_t swap_slot;    /* Swap slot holding the page, or SWAP_ERROR. */
+
+  /* Where the page's contents come from, if it is in neither a
+     frame nor swap: READ_BYTES bytes of FILE starting at OFS,
+     then zeros to the end of the page.  A zero page has a null
+     FILE. */
+  struct file* file; /* File to read from, or a null pointer. */
+  off_t ofs;         /* Offset in FILE. */
+  size_t read_bytes; /* Bytes to read from FILE. */
+  bool mapped;       /* Write back to FILE instead of swapping? */
+
+  struct hash_elem hash_elem; /* Element in process's page table. */
+};
+
+void page_init(void);
+bool page_table_init(struct hash*);
+void page_table_destroy(struct hash*);
+
+struct page* page_add(void* upage, struct file*, off_t, size_t read_bytes, bool writable);
+bool page_grow_stack(const void* uaddr, const void* esp);
+void page_remove(const void* upage);
+struct page* page_lookup(const void* uaddr);
+bool page_load(const void* uaddr);
+bool page_pin_range(const void* uaddr, size_t size, bool write);
+void page_unpin_range(const void* uaddr, size_t size);
+
+/* For the frame table. */
+bool page_accessed_recently(struct page*);
+bool page_evict(struct page*);
+
+#endif /* vm/page.h */
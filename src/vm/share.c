@@ -0,0 +1,136 @@
+/* Shared executable pages.
+
+   Every process running the same executable maps the same
+   frames for the executable's read-only pages, found in a table
+   keyed by inode and file offset.  Each shared frame counts the
+   pages that map it.  The first process to touch a page reads it
+   into a frame, later ones just map that frame, and the last one
+   to unmap it frees the frame.
+
+   Shared frames stay pinned for as long as they are mapped, so
+   the frame table never has to find and unmap every process
+   using one.  Executables can't be written while they are
+   running, so a shared frame always matches its file.  Each
+   entry keeps its inode open, so the inode can't be freed and
+   its address reused by another file while the entry exists. */
+
+#include "vm/share.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "vm/frame.h"
+
+static struct hash shares;     /* Table of shared pages. */
+static struct lock share_lock; /* Protects SHARES and each REF_CNT. */
+static long long map_cnt;      /* Number of share_acquire() calls. */
+static long long read_cnt;     /* Number of pages read in. */
+
+static hash_hash_func share_hash;
+static hash_less_func share_less;
+
+/* Initializes the table of shared pages. */
+void share_init(void) {
+  if (!hash_init(&shares, share_hash, share_less, NULL))
+    PANIC("shared page table creation failed");
+  lock_init(&share_lock);
+}
+
+/* Returns the shared frame holding the READ_BYTES bytes of FILE
+   at OFS, followed by zeros, reading it in if no process has it
+   yet, and adds a reference to it.  FILE must be an executable
+   that can't be written.  Returns a null pointer if no frame is
+   available or the page can't be read. */
+struct share* share_acquire(struct file* file, off_t ofs, size_t read_bytes) {
+  struct share key, *s;
+  struct hash_elem* e;
+
+  /* Find or create the table entry and take a reference, so it
+     stays put while we read it in. */
+  key.inode = file_get_inode(file);
+  key.ofs = ofs;
+  key.read_bytes = read_bytes;
+  lock_acquire(&share_lock);
+  map_cnt++;
+  e = hash_find(&shares, &key.hash_elem);
+  if (e != NULL)
+    s = hash_entry(e, struct share, hash_elem);
+  else {
+    s = malloc(sizeof *s);
+    if (s == NULL) {
+      lock_release(&share_lock);
+      return NULL;
+    }
+    *s = key;
+    s->inode = inode_reopen(key.inode);
+    s->ref_cnt = 0;
+    lock_init(&s->lock);
+    s->frame = NULL;
+    hash_insert(&shares, &s->hash_elem);
+  }
+  s->ref_cnt++;
+  lock_release(&share_lock);
+
+  /* Read the page in, unless another process already did. */
+  lock_acquire(&s->lock);
+  if (s->frame == NULL) {
+    struct frame* f = frame_alloc(NULL);
+    if (f != NULL && file_read_at(file, f->kpage, read_bytes, ofs) == (off_t)read_bytes) {
+      memset((uint8_t*)f->kpage + read_bytes, 0, PGSIZE - read_bytes);
+      s->frame = f;
+      read_cnt++;
+    } else if (f != NULL)
+      frame_free(f);
+  }
+  lock_release(&s->lock);
+
+  if (s->frame == NULL) {
+    share_release(s);
+    return NULL;
+  }
+  return s;
+}
+
+/* Drops a reference to S, freeing its frame if it was the last
+   one.  The caller must already have unmapped its page. */
+void share_release(struct share* s) {
+  bool last;
+
+  lock_acquire(&share_lock);
+  last = --s->ref_cnt == 0;
+  if (last)
+    hash_delete(&shares, &s->hash_elem);
+  lock_release(&share_lock);
+
+  if (last) {
+    if (s->frame != NULL)
+      frame_free(s->frame);
+    inode_close(s->inode);
+    free(s);
+  }
+}
+
+/* Prints shared page statistics. */
+void share_print_stats(void) {
+  printf("Shared pages: %lld mapped, %lld read in\n", map_cnt, read_cnt);
+}
+
+/* Returns a hash value for the shared page with hash element E. */
+static unsigned share_hash(const struct hash_elem* e, void* aux UNUSED) {
+  const struct share* s = hash_entry(e, struct share, hash_elem);
+  return hash_bytes(&s->inode, sizeof s->inode) ^ hash_int(s->ofs);
+}
+
+/* Returns true if shared page A precedes shared page B. */
+static bool share_less(const struct hash_elem* a_, const struct hash_elem* b_, void* aux UNUSED) {
+  const struct share* a = hash_entry(a_, struct share, hash_elem);
+  const struct share* b = hash_entry(b_, struct share, hash_elem);
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  if (a->ofs != b->ofs)
+    return a->ofs < b->ofs;
+  return a->read_bytes < b->read_bytes;
+}
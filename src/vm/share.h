@@ -0,0 +1,30 @@
+#ifndef VM_SHARE_H
+#define VM_SHARE_H
+
+#include <hash.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+struct file;
+struct inode;
+
+/* A read-only page of an executable, held in one frame and
+   mapped by every process running the executable. */
+struct share {
+  struct inode* inode; /* Executable's inode, held open. */
+  off_t ofs;           /* Offset of the page in the file. */
+  size_t read_bytes;   /* Bytes read from the file; the rest are zeros. */
+  size_t ref_cnt;      /* Number of pages mapping the frame. */
+
+  struct lock lock;           /* Held while FRAME is read in. */
+  struct frame* frame;        /* Frame holding the page. */
+  struct hash_elem hash_elem; /* Element in table of shared pages. */
+};
+
+void share_init(void);
+struct share* share_acquire(struct file*, off_t ofs, size_t read_bytes);
+void share_release(struct share*);
+void share_print_stats(void);
+
+#endif /* vm/share.h */
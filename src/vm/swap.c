@@ -0,0 +1,67 @@
+/* Swap slots.
+
+   The swap partition is divided into page-sized slots, tracked
+   by a bitmap.  Pages are written to and read from the device
+   directly, bypassing the buffer cache, since a page that is
+   swapped out is not going to be read again soon. */
+
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include "devices/block.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Number of sectors in a swap slot. */
+#define SECTORS_PER_SLOT (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block* swap_device; /* Swap partition, or a null pointer. */
+static struct bitmap* used_map;   /* Slots in use. */
+static struct lock swap_lock;     /* Protects USED_MAP. */
+
+/* Initializes the swap slot allocator.  With no swap partition,
+   there are no slots and only clean pages can be evicted. */
+void swap_init(void) {
+  size_t slot_cnt = 0;
+
+  swap_device = block_get_role(BLOCK_SWAP);
+  if (swap_device != NULL)
+    slot_cnt = block_size(swap_device) / SECTORS_PER_SLOT;
+  used_map = bitmap_create(slot_cnt);
+  if (used_map == NULL)
+    PANIC("swap bitmap creation failed");
+  lock_init(&swap_lock);
+}
+
+/* Writes the page at KPAGE to a free swap slot and returns the
+   slot, or SWAP_ERROR if swap is full. */
+size_t swap_out(const void* kpage) {
+  size_t slot;
+
+  lock_acquire(&swap_lock);
+  slot = bitmap_scan_and_flip(used_map, 0, 1, false);
+  lock_release(&swap_lock);
+  if (slot == BITMAP_ERROR)
+    return SWAP_ERROR;
+
+  block_write_multiple(swap_device, slot * SECTORS_PER_SLOT, kpage, SECTORS_PER_SLOT);
+  return slot;
+}
+
+/* Reads SLOT into the page at KPAGE and frees SLOT. */
+void swap_in(size_t slot, void* kpage) {
+  size_t i;
+
+  ASSERT(bitmap_test(used_map, slot));
+  for (i = 0; i < SECTORS_PER_SLOT; i++)
+    block_read(swap_device, slot * SECTORS_PER_SLOT + i, (uint8_t*)kpage + i * BLOCK_SECTOR_SIZE);
+  swap_free(slot);
+}
+
+/* Frees SLOT without reading it. */
+void swap_free(size_t slot) {
+  lock_acquire(&swap_lock);
+  ASSERT(bitmap_test(used_map, slot));
+  bitmap_reset(used_map, slot);
+  lock_release(&swap_lock);
+}
@@ -0,0 +1,15 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* A swap slot number that is never allocated. */
+#define SWAP_ERROR SIZE_MAX
+
+void swap_init(void);
+size_t swap_out(const void* kpage);
+void swap_in(size_t slot, void* kpage);
+void swap_free(size_t slot);
+
+#endif /* vm/swap.h */